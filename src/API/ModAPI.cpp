@@ -4,14 +4,106 @@
 
 export module TrueFlasks.API.ModAPI;
 
+import TrueFlasks.Core.CallbackRegistry;
+
 namespace api::mod_api
 {
     using PlayFlaskGlowCallback = TrueFlasksAPI::PlayFlaskGlowCallback;
-  
-    export auto get_play_flasks_glow_callbacks() -> std::map<SKSE::PluginHandle, PlayFlaskGlowCallback>*
+    using FlaskEventCallback = TrueFlasksAPI::FlaskEventCallback;
+    using FlaskEvent = TrueFlasksAPI::FlaskEvent;
+    using APIResult = TrueFlasksAPI::APIResult;
+
+    export using play_flask_glow_callbacks = core::callback_registry::registry<PlayFlaskGlowCallback>;
+    export using flask_event_callbacks = core::callback_registry::registry<FlaskEventCallback>;
+
+    export auto get_play_flasks_glow_callbacks() -> play_flask_glow_callbacks*
     {
-      static std::map<SKSE::PluginHandle, PlayFlaskGlowCallback> callbacks{};
+      static play_flask_glow_callbacks callbacks{};
       return std::addressof(callbacks);
     }
-  
+
+    // Upper bound of pending events, further events are dropped until subscribers catch up.
+    constexpr std::size_t kMaxQueuedFlaskEvents = 4096;
+    // Events handed to subscribers per frame, the rest waits for the next frame.
+    constexpr std::size_t kMaxDispatchedFlaskEventsPerFrame = 256;
+
+    struct flask_events_state
+    {
+      std::mutex queue_mutex;
+      std::vector<FlaskEvent> queue;
+      std::size_t dropped{0};
+
+      flask_event_callbacks callbacks;
+    };
+
+    auto get_flask_events_state() -> flask_events_state&
+    {
+      static flask_events_state state;
+      return state;
+    }
+
+    export auto add_flask_event_callback(const SKSE::PluginHandle plugin_handle, FlaskEventCallback callback) -> APIResult
+    {
+      return get_flask_events_state().callbacks.add(plugin_handle, std::move(callback)) ? APIResult::OK
+                                                                                     : APIResult::AlreadyRegistered;
+    }
+
+    export auto remove_flask_event_callback(const SKSE::PluginHandle plugin_handle) -> APIResult
+    {
+      return get_flask_events_state().callbacks.remove(plugin_handle) ? APIResult::OK : APIResult::NotRegistered;
+    }
+
+    // Cheap check for gameplay code, lets it skip gathering event data when nobody listens.
+    export auto has_flask_event_subscribers() -> bool
+    {
+      return !get_flask_events_state().callbacks.empty();
+    }
+
+    export auto push_flask_event(const FlaskEvent& event) -> void
+    {
+      if (!has_flask_event_subscribers()) {
+        return;
+      }
+
+      auto& state = get_flask_events_state();
+      std::lock_guard<std::mutex> lock(state.queue_mutex);
+      if (state.queue.size() >= kMaxQueuedFlaskEvents) {
+        state.dropped++;
+        return;
+      }
+      state.queue.push_back(event);
+    }
+
+    // Hands at most kMaxDispatchedFlaskEventsPerFrame queued events to every subscriber as one batch.
+    // Runs on the main thread; callbacks run outside of the queue lock so they may (un)register freely.
+    export auto dispatch_flask_events() -> void
+    {
+      auto& state = get_flask_events_state();
+      static std::vector<FlaskEvent> batch;
+
+      batch.clear();
+      {
+        std::lock_guard<std::mutex> lock(state.queue_mutex);
+        if (state.queue.empty()) {
+          return;
+        }
+        if (state.dropped > 0) {
+          logger::warn("Flask event queue overflow, dropped {} event(s)", state.dropped);
+          state.dropped = 0;
+        }
+        const auto count = (std::min)(state.queue.size(), kMaxDispatchedFlaskEventsPerFrame);
+        batch.assign(state.queue.begin(), state.queue.begin() + static_cast<std::ptrdiff_t>(count));
+        state.queue.erase(state.queue.begin(), state.queue.begin() + static_cast<std::ptrdiff_t>(count));
+      }
+
+      state.callbacks.invoke_all(std::span<const FlaskEvent>{batch});
+    }
+
+    // Main thread, frame end: frees callback lists replaced during the frame once no reader is left in them.
+    export auto reclaim_callbacks() -> void
+    {
+      get_play_flasks_glow_callbacks()->reclaim();
+      get_flask_events_state().callbacks.reclaim();
+    }
+
 }
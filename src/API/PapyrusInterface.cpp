@@ -5,6 +5,7 @@
 export module TrueFlasks.Papyrus;
 
 import TrueFlasks.Features.TrueFlasks;
+import TrueFlasks.API.ModAPI;
 
 namespace papyrus
 {
@@ -17,7 +18,14 @@ namespace papyrus
     case 0: return flask_type::Health;
     case 1: return flask_type::Stamina;
     case 2: return flask_type::Magick;
-    default: return flask_type::Other;
+    case 3: return flask_type::Other;
+    default:
+      // Config-defined categories start at 4 and end at the configured count, anything else keeps mapping to Other.
+      if (type > 3 && type <= (std::numeric_limits<std::uint8_t>::max)() &&
+          is_valid_flask_type(static_cast<flask_type>(type))) {
+        return static_cast<flask_type>(type);
+      }
+      return flask_type::Other;
     }
   }
 
@@ -70,6 +78,120 @@ namespace papyrus
     api_play_flask_glow(actor, int_to_flask_type(type));
   }
   
+  // Values per flask type in GetFlaskState: current slots, max slots, next cooldown, cooldown pct, regen mult.
+  constexpr std::size_t kFlaskStateStride = 5;
+
+  // All types in one call, type t starts at index t * 5. Empty for a null actor.
+  std::vector<float> GetFlaskState(RE::StaticFunctionTag*, RE::Actor* actor)
+  {
+    TrueFlasksAPI::FlaskSnapshot snapshot{};
+    if (!actor || !api_get_flask_snapshot(actor, snapshot)) return {};
+
+    std::vector<float> state;
+    state.reserve(std::size(snapshot.types) * kFlaskStateStride);
+    for (const auto& type : snapshot.types) {
+      state.push_back(static_cast<float>(type.current_slots));
+      state.push_back(static_cast<float>(type.max_slots));
+      state.push_back(type.next_cooldown);
+      state.push_back(type.cooldown_pct);
+      state.push_back(type.regen_mult);
+    }
+    return state;
+  }
+
+  // OnFlaskStateChanged(Actor akActor, int aiType, int aiEvent, int aiReason, int aiCurrentSlots, int aiMaxSlots)
+  // aiEvent and aiReason follow TrueFlasksAPI::FlaskEventType and TrueFlasksAPI::DrinkBlockedReason.
+  struct flask_state_changed_registrations final
+    : SKSE::RegistrationSet<RE::Actor*, std::int32_t, std::int32_t, std::int32_t, std::int32_t, std::int32_t>
+  {
+    flask_state_changed_registrations() : RegistrationSet("OnFlaskStateChanged"sv)
+    {
+    }
+
+    [[nodiscard]] auto empty() const -> bool
+    {
+      Locker locker(_lock);
+      return _handles.empty();
+    }
+  };
+
+  constexpr uint32_t kFlaskStateChangedRecord = 'FSCE';
+  constexpr uint32_t kFlaskStateChangedVersion = 1;
+
+  auto get_flask_state_changed_registrations() -> flask_state_changed_registrations&
+  {
+    static flask_state_changed_registrations registrations;
+    return registrations;
+  }
+
+  void forward_flask_events(const std::span<const TrueFlasksAPI::FlaskEvent> events)
+  {
+    auto& registrations = get_flask_state_changed_registrations();
+    for (const auto& event : events) {
+      const auto actor = RE::TESForm::LookupByID<RE::Actor>(event.actor);
+      if (!actor) continue;
+      registrations.SendEvent(actor, static_cast<std::int32_t>(event.type), static_cast<std::int32_t>(event.event),
+                              static_cast<std::int32_t>(event.reason), event.current_slots, event.max_slots);
+    }
+  }
+
+  // Scripts listen through the same batched event queue as SKSE plugins. The forwarder is only subscribed
+  // while a script is registered, so without listeners gameplay code skips building events entirely.
+  void sync_event_forwarding()
+  {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto handle = SKSE::GetPluginHandle();
+    if (get_flask_state_changed_registrations().empty()) {
+      api::mod_api::remove_flask_event_callback(handle);
+      return;
+    }
+    api::mod_api::add_flask_event_callback(handle, forward_flask_events);
+  }
+
+  bool RegisterForFlaskStateChanged(RE::StaticFunctionTag*, RE::TESForm* form)
+  {
+    if (!form) return false;
+    const auto registered = get_flask_state_changed_registrations().Register(form);
+    sync_event_forwarding();
+    return registered;
+  }
+
+  bool UnregisterForFlaskStateChanged(RE::StaticFunctionTag*, RE::TESForm* form)
+  {
+    if (!form) return false;
+    const auto unregistered = get_flask_state_changed_registrations().Unregister(form);
+    sync_event_forwarding();
+    return unregistered;
+  }
+
+  export void save(SKSE::SerializationInterface* a_interface)
+  {
+    if (!get_flask_state_changed_registrations().Save(a_interface, kFlaskStateChangedRecord,
+                                                       kFlaskStateChangedVersion)) {
+      logger::error("Failed to save OnFlaskStateChanged registrations");
+    }
+  }
+
+  // Returns false if the record belongs to someone else.
+  export bool load_record(SKSE::SerializationInterface* a_interface, const uint32_t type)
+  {
+    if (type != kFlaskStateChangedRecord) return false;
+
+    if (!get_flask_state_changed_registrations().Load(a_interface)) {
+      logger::error("Failed to load OnFlaskStateChanged registrations");
+    }
+    sync_event_forwarding();
+    return true;
+  }
+
+  export void revert(SKSE::SerializationInterface* a_interface)
+  {
+    get_flask_state_changed_registrations().Revert(a_interface);
+    sync_event_forwarding();
+  }
+  
   void ConsumeFlaskSlot(RE::StaticFunctionTag*, RE::Actor* actor, int type, const int count)
   {
     if (!actor) return;
@@ -90,10 +212,15 @@ namespace papyrus
     vm->RegisterFunction("GetCurrentSlots", "TrueFlasksNG", GetCurrentSlots);
     vm->RegisterFunction("GetRegenMult", "TrueFlasksNG", GetRegenMult);
     vm->RegisterFunction("GetCooldownPct", "TrueFlasksNG", GetCooldownPct);
-    vm->RegisterFunction("GetFlaskInfo", "TrueFlasksNG", GetFlaskInfo);
+    // Only reads form data and the config, so it does not need to wait for the main thread.
+    vm->RegisterFunction("GetFlaskInfo", "TrueFlasksNG", GetFlaskInfo, true);
     vm->RegisterFunction("PlayFlaskGlow", "TrueFlasksNG", PlayFlaskGlow);
     vm->RegisterFunction("ConsumeFlaskSlot", "TrueFlasksNG", ConsumeFlaskSlot);
     vm->RegisterFunction("RestoreFlaskSlot", "TrueFlasksNG", RestoreFlaskSlot);
+    vm->RegisterFunction("GetFlaskState", "TrueFlasksNG", GetFlaskState);
+    // Registration sets guard themselves with a lock.
+    vm->RegisterFunction("RegisterForFlaskStateChanged", "TrueFlasksNG", RegisterForFlaskStateChanged, true);
+    vm->RegisterFunction("UnregisterForFlaskStateChanged", "TrueFlasksNG", UnregisterForFlaskStateChanged, true);
     return true;
   }
 }
@@ -7,7 +7,7 @@ namespace api
 {
   using namespace TrueFlasksAPI;
 
-  class TrueFlasksAPI : public IVTrueFlasks2
+  class TrueFlasksAPI : public IVTrueFlasks3
   {
   public:
     void ModifyCooldown(RE::Actor* actor, FlaskType type, float amount, bool all_slots) noexcept override
@@ -59,21 +59,17 @@ namespace api
     APIResult AddPlayFlaskGlowCallback(SKSE::PluginHandle plugin_handle,
       PlayFlaskGlowCallback glow_callback) noexcept override
     {
-      auto callbacks = mod_api::get_play_flasks_glow_callbacks();
-      if (callbacks->contains(plugin_handle)) {
+      if (!mod_api::get_play_flasks_glow_callbacks()->add(plugin_handle, std::move(glow_callback))) {
         return APIResult::AlreadyRegistered;
       }
-      callbacks->emplace(plugin_handle, glow_callback);
       return APIResult::OK;
     }
     
     APIResult RemovePlayFlaskGlowCallback(SKSE::PluginHandle plugin_handle) noexcept override
     {
-      auto callbacks = mod_api::get_play_flasks_glow_callbacks();
-      if (!callbacks->contains(plugin_handle)) {
+      if (!mod_api::get_play_flasks_glow_callbacks()->remove(plugin_handle)) {
         return APIResult::NotRegistered;
       }
-      callbacks->erase(plugin_handle);
       return APIResult::OK;
     }
     
@@ -86,6 +82,26 @@ namespace api
     {
       return features::true_flasks::api_restore_flask_slot(actor, static_cast<features::true_flasks::flask_type>(type), count);
     }
+
+    bool GetFlaskSnapshot(RE::Actor* actor, FlaskSnapshot& out) noexcept override
+    {
+      return features::true_flasks::api_get_flask_snapshot(actor, out);
+    }
+
+    std::size_t GetFlaskSnapshots(std::span<RE::Actor* const> actors, std::span<FlaskSnapshot> out) noexcept override
+    {
+      return features::true_flasks::api_get_flask_snapshots(actors, out);
+    }
+
+    APIResult AddFlaskEventCallback(SKSE::PluginHandle plugin_handle, FlaskEventCallback event_callback) noexcept override
+    {
+      return mod_api::add_flask_event_callback(plugin_handle, std::move(event_callback));
+    }
+
+    APIResult RemoveFlaskEventCallback(SKSE::PluginHandle plugin_handle) noexcept override
+    {
+      return mod_api::remove_flask_event_callback(plugin_handle);
+    }
     
   };
   
@@ -96,6 +112,7 @@ namespace api
     switch (interfaceVersion) {
     case InterfaceVersion::V1:
     case InterfaceVersion::V2:
+    case InterfaceVersion::V3:
       return &g_TrueFlasksAPI;
     default:
       return nullptr;
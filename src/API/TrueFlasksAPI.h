@@ -13,7 +13,8 @@ namespace TrueFlasksAPI
   enum class InterfaceVersion : uint8_t
   {
     V1,
-    V2
+    V2,
+    V3
   };
 
   /// <summary>
@@ -67,6 +68,68 @@ namespace TrueFlasksAPI
       bool revert_exclusive;
   };
 
+  /// <summary>
+  /// State of a single flask type, as returned by the individual getters of IVTrueFlasks1.
+  /// </summary>
+  struct FlaskTypeSnapshot
+  {
+    int current_slots;
+    int max_slots;
+    float next_cooldown;
+    float cooldown_pct;
+    float regen_mult;
+  };
+
+  /// <summary>
+  /// State of all flask types of an actor, indexed by FlaskType.
+  /// </summary>
+  struct FlaskSnapshot
+  {
+    FlaskTypeSnapshot types[4];
+  };
+
+  /// <summary>
+  /// Kinds of flask state changes reported to event subscribers.
+  /// </summary>
+  enum class FlaskEventType : uint8_t
+  {
+    SlotConsumed = 0,
+    SlotRestored = 1,
+    SlotReady = 2,
+    CapChanged = 3,
+    DrinkBlocked = 4
+  };
+
+  /// <summary>
+  /// Why a drink was blocked, None for all other event types.
+  /// </summary>
+  enum class DrinkBlockedReason : uint8_t
+  {
+    None = 0,
+    AntiSpam = 1,
+    Empty = 2
+  };
+
+  /// <summary>
+  /// A single flask state change. Counts are the state right after the change.
+  /// </summary>
+  struct FlaskEvent
+  {
+    FlaskEventType event;
+    FlaskType type;
+    DrinkBlockedReason reason;
+    RE::FormID actor;
+    int current_slots;
+    int max_slots;
+  };
+
+  /// <summary>
+  /// Callback function signature for flask events.
+  /// Called on the main thread once per frame with all events queued since the previous batch.
+  /// The span is only valid for the duration of the call.
+  /// </summary>
+  using FlaskEventCallback = std::function<void(std::span<const FlaskEvent>)>;
+
   /// <summary>
   /// Callback function signature for handling flask glow events.
   /// Parameters:
@@ -169,7 +232,7 @@ namespace TrueFlasksAPI
   /// <summary>
   /// Interface for interacting with the TrueFlasksNG plugin (Version 2).
   /// </summary>
-  class IVTrueFlasks2 : IVTrueFlasks1
+  class IVTrueFlasks2 : public IVTrueFlasks1
   {
   public:
     /// <summary>
@@ -184,10 +247,54 @@ namespace TrueFlasksAPI
     virtual bool RestoreFlaskSlot(RE::Actor* actor, FlaskType type, const int count) noexcept = 0;
   };
 
+  /// <summary>
+  /// Interface for interacting with the TrueFlasksNG plugin (Version 3).
+  /// </summary>
+  class IVTrueFlasks3 : public IVTrueFlasks2
+  {
+  public:
+    /// <summary>
+    /// Fills the state of all flask types for the actor in a single pass.
+    /// Cheaper than calling the individual getters for every type each frame.
+    /// </summary>
+    /// <param name="actor">The target actor.</param>
+    /// <param name="out">Receives the state of every flask type.</param>
+    /// <returns>True if the snapshot was filled, false if the actor is null.</returns>
+    virtual bool GetFlaskSnapshot(RE::Actor* actor, FlaskSnapshot& out) noexcept = 0;
+
+    /// <summary>
+    /// Fills the snapshots of several actors at once, e.g. for follower and party HUDs.
+    /// The internal cache is locked once for the whole batch and active effects are visited once per actor.
+    /// </summary>
+    /// <param name="actors">The target actors, null entries are allowed.</param>
+    /// <param name="out">Receives out[i] for actors[i], only the first min(actors.size(), out.size()) entries are written.
+    /// Entries for null actors are zeroed.</param>
+    /// <returns>Number of snapshots filled for non-null actors.</returns>
+    virtual std::size_t GetFlaskSnapshots(std::span<RE::Actor* const> actors, std::span<FlaskSnapshot> out) noexcept = 0;
+
+    /// <summary>
+    /// Registers a callback that receives flask events (slot consumed, restored, ready, cap changed, drink blocked).
+    /// Events are queued when they happen and delivered in batches from the player update, so the callback
+    /// never runs inside the drink or update path itself.
+    /// </summary>
+    /// <param name="plugin_handle">The SKSE plugin handle of the registering plugin.</param>
+    /// <param name="event_callback">The callback function to execute.</param>
+    /// <returns>APIResult::OK if registered successfully.</returns>
+    virtual APIResult AddFlaskEventCallback(SKSE::PluginHandle plugin_handle, FlaskEventCallback event_callback) noexcept = 0;
+
+    /// <summary>
+    /// Unregisters the flask event callback for the specified plugin.
+    /// </summary>
+    /// <param name="plugin_handle">The SKSE plugin handle of the registering plugin.</param>
+    /// <returns>APIResult::OK if removed successfully.</returns>
+    virtual APIResult RemoveFlaskEventCallback(SKSE::PluginHandle plugin_handle) noexcept = 0;
+  };
+
   typedef void* (*_RequestPluginAPI)(const InterfaceVersion interfaceVersion);
 
   /// <summary>
-  /// Requests the plugin API interface.
+  /// Requests the plugin API interface. The default stays V2 so existing callers keep the interface they cast to;
+  /// request InterfaceVersion::V3 explicitly for the snapshot and event functions.
   /// </summary>
   /// <param name="a_interfaceVersion">The requested interface version.</param>
   /// <returns>Pointer to the API interface or nullptr if not found.</returns>
@@ -7,6 +7,11 @@ export module TrueFlasks.Config;
 
 import TrueFlasks.Events.EventsCtx;
 import TrueFlasks.Core.Utility;
+import TrueFlasks.Core.MenuTracker;
+import TrueFlasks.Core.AllocationProfiler;
+import TrueFlasks.Core.Telemetry;
+import TrueFlasks.Core.ActorsCache;
+import TrueFlasks.Core.KeywordIndex;
 
 namespace config
 {
@@ -66,9 +71,40 @@ namespace config
     bool revert_exclusive{false};
   };
 
+  // Config-defined cooldown group such as resist potions or cures, read from a [FlasksCategory.<Name>] section.
+  // Potions with the category keyword share its slots; it is checked after the built-in keywords and before Other.
+  export struct flask_category_settings : flask_settings
+  {
+    std::string name;
+  };
+
+  export constexpr std::string_view kFlaskCategorySectionPrefix = "FlasksCategory.";
+  export constexpr std::size_t kMaxFlaskCategories = 60;
+
   export struct main_settings
   {
     RE::BGSKeyword* no_remove_keyword{nullptr};
+    bool game_time_catch_up{false};
+    bool hot_reload{true};
+    // Counts the plugin's heap allocations per call site for the diagnostics page.
+    bool allocation_profiling{false};
+    // Appends session performance totals to a CSV in the SKSE log directory on every save and at exit.
+    bool telemetry_export{false};
+    // Flask hotkeys are ignored while any of these menus is open.
+    std::vector<std::string> hotkey_blocking_menus{
+      std::string{RE::TweenMenu::MENU_NAME}, std::string{RE::DialogueMenu::MENU_NAME},
+      std::string{RE::MagicMenu::MENU_NAME}, std::string{RE::InventoryMenu::MENU_NAME},
+      std::string{RE::LockpickingMenu::MENU_NAME}, std::string{RE::RaceSexMenu::MENU_NAME},
+      std::string{RE::StatsMenu::MENU_NAME}, std::string{RE::LoadingMenu::MENU_NAME},
+      std::string{RE::Console::MENU_NAME}, std::string{RE::FaderMenu::MENU_NAME},
+      std::string{RE::FavoritesMenu::MENU_NAME}, std::string{RE::SleepWaitMenu::MENU_NAME},
+      std::string{RE::JournalMenu::MENU_NAME}, std::string{RE::BarterMenu::MENU_NAME},
+      std::string{RE::MainMenu::MENU_NAME}, std::string{RE::BookMenu::MENU_NAME},
+      std::string{RE::ContainerMenu::MENU_NAME}, std::string{RE::GiftMenu::MENU_NAME},
+      std::string{RE::MessageBoxMenu::MENU_NAME}, std::string{RE::TrainingMenu::MENU_NAME},
+      std::string{RE::MapMenu::MENU_NAME}, std::string{RE::TutorialMenu::MENU_NAME},
+      std::string{RE::LevelUpMenu::MENU_NAME}, std::string{RE::CreditsMenu::MENU_NAME},
+      "LootMenuIE", "LootMenu"};
   };
 
   export struct prisma_flask_widget_settings
@@ -92,6 +128,17 @@ namespace config
     float size{0.50f};
     float opacity{1.00f};
     bool anchor_all_elements{true};
+    // The widget is hidden while any of these menus is open.
+    std::vector<std::string> hide_menus{
+      std::string{RE::InventoryMenu::MENU_NAME}, std::string{RE::CraftingMenu::MENU_NAME},
+      std::string{RE::BarterMenu::MENU_NAME}, std::string{RE::TweenMenu::MENU_NAME},
+      std::string{RE::GiftMenu::MENU_NAME}, std::string{RE::ContainerMenu::MENU_NAME},
+      std::string{RE::MagicMenu::MENU_NAME}, std::string{RE::DialogueMenu::MENU_NAME},
+      std::string{RE::StatsMenu::MENU_NAME}, std::string{RE::MessageBoxMenu::MENU_NAME},
+      std::string{RE::JournalMenu::MENU_NAME}, std::string{RE::LockpickingMenu::MENU_NAME},
+      std::string{RE::SleepWaitMenu::MENU_NAME}, std::string{RE::RaceSexMenu::MENU_NAME},
+      std::string{RE::MapMenu::MENU_NAME}, std::string{RE::FaderMenu::MENU_NAME},
+      std::string{RE::CursorMenu::MENU_NAME}, std::string{RE::LoadingMenu::MENU_NAME}};
 
     prisma_flask_widget_settings health;
     prisma_flask_widget_settings stamina;
@@ -99,17 +146,19 @@ namespace config
     prisma_flask_widget_settings other;
   };
 
-  export class config_manager final
+  // Every setting read from the INI. Keyword and sound fields are only filled once forms are resolved.
+  export struct config_values
   {
-  public:
     main_settings main;
     flask_other_settings flasks_other;
     flask_settings flasks_health;
     flask_settings flasks_stamina;
     flask_settings flasks_magick;
+    // In INI order, category i has the flask type index 4 + i.
+    std::vector<flask_category_settings> categories;
     prisma_widget_settings prisma_widget;
 
-    config_manager()
+    config_values()
     {
       // Health Flasks Defaults
       flasks_health.notify = "I can't drink any more Healing Flasks.";
@@ -131,11 +180,157 @@ namespace config
       prisma_widget.magick = {0.50f, 0.63f, 0.50f, 1.00f, true, false};
       prisma_widget.other = {0.50f, 0.50f, 0.50f, 1.00f, true, false};
     }
+  };
+
+  // Read-only copy of the settings handed to gameplay code. Every change publishes a new one with a higher version,
+  // so caches derived from settings only need to compare versions to know when to rebuild.
+  // Keyword masks of one flask type, compiled with its snapshot. An unset keyword gives an empty mask.
+  export struct type_keyword_masks final
+  {
+    // The type's flask keyword, empty for Other.
+    core::keyword_index::keyword_mask flask;
+    core::keyword_index::keyword_mask inventory;
+    core::keyword_index::keyword_mask cap;
+    core::keyword_index::keyword_mask cooldown;
+    core::keyword_index::keyword_mask regeneration_mult;
+  };
+
+  // Three built-in flask keywords, one per category, Other's exclusive keyword, NoRemoveKeyword, then four keywords
+  // per type.
+  static_assert(core::keyword_index::kMaxIndexedKeywords >= 5 + kMaxFlaskCategories + 4 * (4 + kMaxFlaskCategories));
+
+  // Read-only copy of the settings handed to gameplay code. Every change publishes a new one with a higher version,
+  // so caches derived from settings only need to compare versions to know when to rebuild.
+  export struct settings_snapshot final
+  {
+    std::uint64_t version{0};
+    config_values values;
+    // Every configured keyword gets its bit when the snapshot is compiled, so callers test masks only.
+    core::keyword_index::keyword_bits keyword_bits;
+    // Indexed by flask type.
+    std::vector<type_keyword_masks> type_masks;
+    // Every flask keyword of the built-in types and categories.
+    core::keyword_index::keyword_mask flask_keywords;
+    core::keyword_index::keyword_mask other_exclusive;
+    core::keyword_index::keyword_mask no_remove;
+    // Cap, cooldown and regeneration masks of every type, input-major, for the one-walk effect sums. Empty when
+    // no type has any of them.
+    std::vector<core::keyword_index::keyword_mask> effect_input_masks;
+  };
+
+  // Assigns the keyword bits, flask keywords first, and fills the masks of every type.
+  void compile_keyword_masks(settings_snapshot& snapshot)
+  {
+    auto& bits = snapshot.keyword_bits;
+    const auto& values = snapshot.values;
+
+    std::vector<const flask_settings_base*> types{&values.flasks_health, &values.flasks_stamina,
+                                                  &values.flasks_magick, &values.flasks_other};
+    std::vector<const RE::BGSKeyword*> flask_keywords{values.flasks_health.keyword, values.flasks_stamina.keyword,
+                                                      values.flasks_magick.keyword, nullptr};
+    for (const auto& category : values.categories) {
+      types.push_back(&category);
+      flask_keywords.push_back(category.keyword);
+    }
+
+    snapshot.type_masks.resize(types.size());
+    for (std::size_t i = 0; i < types.size(); ++i) {
+      snapshot.type_masks[i].flask = bits.add(flask_keywords[i]);
+      snapshot.flask_keywords |= snapshot.type_masks[i].flask;
+    }
+    snapshot.other_exclusive = bits.add(values.flasks_other.exclusive_keyword);
+    snapshot.no_remove = bits.add(values.main.no_remove_keyword);
+    for (std::size_t i = 0; i < types.size(); ++i) {
+      auto& masks = snapshot.type_masks[i];
+      masks.inventory = bits.add(types[i]->inventory_keyword);
+      masks.cap = bits.add(types[i]->cap_keyword);
+      masks.cooldown = bits.add(types[i]->cooldown_keyword);
+      masks.regeneration_mult = bits.add(types[i]->regeneration_mult_keyword);
+    }
+
+    const auto& type_masks = snapshot.type_masks;
+    if (std::ranges::any_of(type_masks, [](const type_keyword_masks& masks) {
+          return masks.cap.any() || masks.cooldown.any() || masks.regeneration_mult.any();
+        })) {
+      for (const auto member : {&type_keyword_masks::cap, &type_keyword_masks::cooldown,
+                                &type_keyword_masks::regeneration_mult}) {
+        for (const auto& masks : type_masks) {
+          snapshot.effect_input_masks.push_back(masks.*member);
+        }
+      }
+    }
+  }
+
+  // Result of parsing the INI without touching game data, so it can be built on any thread.
+  // Form references are collected and resolved in one batch on the main thread before the snapshot is applied.
+  struct config_snapshot
+  {
+    struct pending_form
+    {
+      std::string value;
+      RE::BGSKeyword** keyword{nullptr};
+      RE::BGSSoundDescriptorForm** sound{nullptr};
+    };
+
+    config_values values;
+    // Point into values, so the snapshot is kept behind a unique_ptr and never moved.
+    std::vector<pending_form> forms;
+  };
 
+  // The config_values members are the editable copy owned by the settings menu and the loaders.
+  // Everything else reads the published settings_snapshot through config::current().
+  export class config_manager final : public config_values
+  {
   private:
     std::filesystem::path config_path_;
     std::mutex mutex_;
 
+    // Published snapshot. Readers share ownership of the one they loaded, so a replaced snapshot is freed by
+    // whoever drops the last reference, however long that reader was stalled.
+    std::atomic<std::shared_ptr<const settings_snapshot>> published_;
+    std::mutex publish_mutex_;
+    // Set by menu edits, published once per frame by publish_pending().
+    std::atomic<bool> publish_requested_{false};
+
+    // Hot reload: the watcher thread parses changed files into pending_, the main thread applies it.
+    static constexpr auto kWatchInterval = std::chrono::seconds(1);
+    std::mutex pending_mutex_;
+    std::unique_ptr<config_snapshot> pending_;
+    std::atomic<bool> has_pending_{false};
+    std::atomic<std::filesystem::file_time_type::rep> known_write_time_{0};
+    std::atomic<bool> hot_reload_enabled_{true};
+
+    // Debounced saving: the menu marks values dirty, the writer thread saves the published snapshot when edits stop.
+    static constexpr auto kSaveDebounce = std::chrono::milliseconds(500);
+    std::mutex save_mutex_;
+    std::condition_variable_any save_wait_;
+    bool save_dirty_{false};
+    std::chrono::steady_clock::time_point last_change_{};
+    bool flush_requested_{false};
+    std::atomic<std::uint64_t> save_requests_{0};
+    std::atomic<std::uint64_t> save_writes_{0};
+
+    // Declared last so both threads are joined before the state they use is destroyed.
+    std::jthread watcher_;
+    std::jthread writer_;
+
+    [[nodiscard]] auto get_write_time() const -> std::optional<std::filesystem::file_time_type>
+    {
+      std::error_code ec;
+      const auto time = std::filesystem::last_write_time(config_path_, ec);
+      if (ec) {
+        return std::nullopt;
+      }
+      return time;
+    }
+
+    void remember_write_time()
+    {
+      if (const auto time = get_write_time()) {
+        known_write_time_.store(time->time_since_epoch().count(), std::memory_order_release);
+      }
+    }
+
     void parse_int(const std::string& val, int& out)
     {
       if (auto res = core::utility::str_to_int64(val); res.has_value()) {
@@ -164,6 +359,29 @@ namespace config
       }
     }
 
+    // Comma separated menu names, e.g. "InventoryMenu, MapMenu". An empty value tracks no menus.
+    void parse_menu_list(const std::string& val, std::vector<std::string>& out)
+    {
+      out.clear();
+      for (const auto& name : core::utility::strings::split(val, ',')) {
+        if (auto trimmed = core::utility::strings::trim(name); !trimmed.empty()) {
+          out.push_back(std::move(trimmed));
+        }
+      }
+    }
+
+    [[nodiscard]] static auto menu_list_to_string(const std::vector<std::string>& names) -> std::string
+    {
+      std::string result;
+      for (const auto& name : names) {
+        if (!result.empty()) {
+          result += ", ";
+        }
+        result += name;
+      }
+      return result;
+    }
+
     [[nodiscard]] auto parse_keyword(const std::string& val) -> RE::BGSKeyword*
     {
       auto res = core::utility::resolved_form_id_from_string(val);
@@ -229,9 +447,25 @@ namespace config
                                                                    true);
     }
 
+    using pending_forms = std::vector<config_snapshot::pending_form>;
+
+    static void defer_keyword(pending_forms& forms, const std::string& val, RE::BGSKeyword*& out)
+    {
+      out = nullptr;
+      forms.push_back({val, &out, nullptr});
+    }
+
+    static void defer_sound_descriptor(pending_forms& forms, const std::string& val,
+                                       RE::BGSSoundDescriptorForm*& out)
+    {
+      out = nullptr;
+      forms.push_back({val, nullptr, &out});
+    }
+
     void read_flask_base(const mINI::INIStructure& ini,
                          const std::string& section,
-                         flask_settings_base& settings)
+                         flask_settings_base& settings,
+                         pending_forms& forms)
     {
       std::string regen_kw = "0x800~Mod.esp";
       std::string cap_kw = "0x800~Mod.esp";
@@ -282,15 +516,16 @@ namespace config
         logger::info("Section [{}] not found, using defaults", section);
       }
 
-      settings.regeneration_mult_keyword = parse_keyword(regen_kw);
-      settings.cap_keyword = parse_keyword(cap_kw);
-      settings.cooldown_keyword = parse_keyword(cd_kw);
-      settings.fail_audio_form = parse_sound_descriptor(fail_sound);
+      defer_keyword(forms, regen_kw, settings.regeneration_mult_keyword);
+      defer_keyword(forms, cap_kw, settings.cap_keyword);
+      defer_keyword(forms, cd_kw, settings.cooldown_keyword);
+      defer_sound_descriptor(forms, fail_sound, settings.fail_audio_form);
     }
 
     void read_inventory_settings(const mINI::INIStructure& ini,
                                  const std::string& section,
-                                 flask_settings_base& settings)
+                                 flask_settings_base& settings,
+                                 pending_forms& forms)
     {
       std::string inventory_kw = "0x800~Mod.esp";
 
@@ -312,13 +547,18 @@ namespace config
           inventory_kw = collection.get("InventoryKeyword");
       }
 
-      settings.inventory_keyword = parse_keyword(inventory_kw);
+      defer_keyword(forms, inventory_kw, settings.inventory_keyword);
     }
 
-    void populate_ini(mINI::INIStructure& ini)
+    void populate_ini(mINI::INIStructure& ini, const config_values& values)
     {
       ini["TrueFlasksNG"]["NoRemoveKeyword"] =
-        keyword_to_string(main.no_remove_keyword, "0x800~Mod.esp");
+        keyword_to_string(values.main.no_remove_keyword, "0x800~Mod.esp");
+      ini["TrueFlasksNG"]["GameTimeCatchUp"] = values.main.game_time_catch_up ? "1" : "0";
+      ini["TrueFlasksNG"]["HotReload"] = values.main.hot_reload ? "1" : "0";
+      ini["TrueFlasksNG"]["AllocationProfiling"] = values.main.allocation_profiling ? "1" : "0";
+      ini["TrueFlasksNG"]["TelemetryExport"] = values.main.telemetry_export ? "1" : "0";
+      ini["TrueFlasksNG"]["HotkeyBlockingMenus"] = menu_list_to_string(values.main.hotkey_blocking_menus);
 
       auto write_flask = [&](const std::string& section,
                              const flask_settings_base& s) {
@@ -352,11 +592,11 @@ namespace config
           sound_descriptor_to_string(s.fail_audio_form, "0x800~Mod.esp");
       };
 
-      write_flask("FlasksOther", flasks_other);
+      write_flask("FlasksOther", values.flasks_other);
       ini["FlasksOther"]["FlasksOtherExclusiveKeyword"] =
-        keyword_to_string(flasks_other.exclusive_keyword, "0x800~Mod.esp");
+        keyword_to_string(values.flasks_other.exclusive_keyword, "0x800~Mod.esp");
       ini["FlasksOther"]["FlasksRevertExclusive"] =
-        flasks_other.revert_exclusive ? "1" : "0";
+        values.flasks_other.revert_exclusive ? "1" : "0";
 
       auto write_flask_full = [&](const std::string& section,
                                   const flask_settings& s) {
@@ -369,25 +609,29 @@ namespace config
           keyword_to_string(s.keyword, "0x800~Mod.esp");
       };
 
-      write_flask_full("FlasksHealth", flasks_health);
-      write_flask_full("FlasksStamina", flasks_stamina);
-      write_flask_full("FlasksMagick", flasks_magick);
+      write_flask_full("FlasksHealth", values.flasks_health);
+      write_flask_full("FlasksStamina", values.flasks_stamina);
+      write_flask_full("FlasksMagick", values.flasks_magick);
+      for (const auto& category : values.categories) {
+        write_flask_full(std::string{kFlaskCategorySectionPrefix} + category.name, category);
+      }
 
       // PrismaWidget
-      ini["PrismaWidget"]["PrismaEnable"] = prisma_widget.enable ? "1" : "0";
-      ini["PrismaWidget"]["AutoHideUI"] = prisma_widget.auto_hide_ui ? "1" : "0";
+      ini["PrismaWidget"]["PrismaEnable"] = values.prisma_widget.enable ? "1" : "0";
+      ini["PrismaWidget"]["AutoHideUI"] = values.prisma_widget.auto_hide_ui ? "1" : "0";
       ini["PrismaWidget"]["AlwaysShowInCombat"] =
-        prisma_widget.always_show_in_combat ? "1" : "0";
+        values.prisma_widget.always_show_in_combat ? "1" : "0";
       ini["PrismaWidget"]["PrismaPositionX"] =
-        std::format("{:.3f}", prisma_widget.x);
+        std::format("{:.3f}", values.prisma_widget.x);
       ini["PrismaWidget"]["PrismaPositionY"] =
-        std::format("{:.3f}", prisma_widget.y);
+        std::format("{:.3f}", values.prisma_widget.y);
       ini["PrismaWidget"]["PrismaSize"] =
-        std::format("{:.3f}", prisma_widget.size);
+        std::format("{:.3f}", values.prisma_widget.size);
       ini["PrismaWidget"]["PrismaOpacity"] =
-        std::format("{:.3f}", prisma_widget.opacity);
+        std::format("{:.3f}", values.prisma_widget.opacity);
       ini["PrismaWidget"]["PrismaAnchorAllElements"] =
-        prisma_widget.anchor_all_elements ? "1" : "0";
+        values.prisma_widget.anchor_all_elements ? "1" : "0";
+      ini["PrismaWidget"]["PrismaHideInMenus"] = menu_list_to_string(values.prisma_widget.hide_menus);
 
       auto write_prisma_flask = [&](const std::string& prefix,
                                     const std::string& type,
@@ -404,15 +648,15 @@ namespace config
           s.fill_animation_only_zero ? "1" : "0";
       };
 
-      write_prisma_flask("PrismaFlasksHealth", "Health", prisma_widget.health);
-      write_prisma_flask("PrismaFlasksStamina", "Stamina", prisma_widget.stamina);
-      write_prisma_flask("PrismaFlasksMagick", "Magick", prisma_widget.magick);
-      write_prisma_flask("PrismaFlasksOther", "Other", prisma_widget.other);
+      write_prisma_flask("PrismaFlasksHealth", "Health", values.prisma_widget.health);
+      write_prisma_flask("PrismaFlasksStamina", "Stamina", values.prisma_widget.stamina);
+      write_prisma_flask("PrismaFlasksMagick", "Magick", values.prisma_widget.magick);
+      write_prisma_flask("PrismaFlasksOther", "Other", values.prisma_widget.other);
     }
 
     void generate_default(const mINI::INIFile& file, mINI::INIStructure& ini)
     {
-      populate_ini(ini);
+      populate_ini(ini, *this);
 
       if (file.generate(ini, true)) {
         logger::info("Default configuration generated");
@@ -423,6 +667,11 @@ namespace config
     }
 
   public:
+    config_manager()
+    {
+      publish();
+    }
+
     static auto get_singleton() -> config_manager*
     {
       static config_manager singleton;
@@ -433,22 +682,18 @@ namespace config
     {
       config_path_ = "Data/SKSE/Plugins/TrueFlasksNG.ini";
       load();
+      watcher_ = std::jthread([this](const std::stop_token& stop) { watch(stop); });
+      writer_ = std::jthread([this](const std::stop_token& stop) { write_loop(stop); });
     }
 
-    auto load() -> void
+  private:
+    // Builds a snapshot from defaults plus the file, touches neither game data nor the live settings.
+    [[nodiscard]] auto parse(const mINI::INIStructure& ini) -> std::unique_ptr<config_snapshot>
     {
-      std::lock_guard<std::mutex> lock(mutex_);
-
-      logger::info("Loading configuration");
-
-      mINI::INIFile file(config_path_);
-      mINI::INIStructure ini;
-
-      if (!file.read(ini)) {
-        logger::info("Configuration file not found, generating default.");
-        generate_default(file, ini);
-        return;
-      }
+      auto snapshot = std::make_unique<config_snapshot>();
+      auto& [main, flasks_other, flasks_health, flasks_stamina, flasks_magick, categories, prisma_widget] =
+        snapshot->values;
+      auto& forms = snapshot->forms;
 
       // [TrueFlasksNG]
       std::string no_remove_kw = "0x800~Mod.esp";
@@ -456,12 +701,22 @@ namespace config
         const auto& sec = ini.get("TrueFlasksNG");
         if (sec.has("NoRemoveKeyword"))
           no_remove_kw = sec.get("NoRemoveKeyword");
+        if (sec.has("GameTimeCatchUp"))
+          parse_bool(sec.get("GameTimeCatchUp"), main.game_time_catch_up);
+        if (sec.has("HotReload"))
+          parse_bool(sec.get("HotReload"), main.hot_reload);
+        if (sec.has("AllocationProfiling"))
+          parse_bool(sec.get("AllocationProfiling"), main.allocation_profiling);
+        if (sec.has("TelemetryExport"))
+          parse_bool(sec.get("TelemetryExport"), main.telemetry_export);
+        if (sec.has("HotkeyBlockingMenus"))
+          parse_menu_list(sec.get("HotkeyBlockingMenus"), main.hotkey_blocking_menus);
       }
-      main.no_remove_keyword = parse_keyword(no_remove_kw);
+      defer_keyword(forms, no_remove_kw, main.no_remove_keyword);
 
       // [FlasksOther]
-      read_flask_base(ini, "FlasksOther", flasks_other);
-      read_inventory_settings(ini, "FlasksOther", flasks_other);
+      read_flask_base(ini, "FlasksOther", flasks_other, forms);
+      read_inventory_settings(ini, "FlasksOther", flasks_other, forms);
       std::string exclusive_kw = "0x800~Mod.esp";
       if (ini.has("FlasksOther")) {
         const auto& sec = ini.get("FlasksOther");
@@ -471,12 +726,12 @@ namespace config
           parse_bool(sec.get("FlasksRevertExclusive"),
                      flasks_other.revert_exclusive);
       }
-      flasks_other.exclusive_keyword = parse_keyword(exclusive_kw);
+      defer_keyword(forms, exclusive_kw, flasks_other.exclusive_keyword);
 
       auto read_flask_full = [&](const std::string& section,
                                  flask_settings& settings) {
-        read_flask_base(ini, section, settings);
-        read_inventory_settings(ini, section, settings);
+        read_flask_base(ini, section, settings, forms);
+        read_inventory_settings(ini, section, settings, forms);
         std::string kw = "0x800~Mod.esp";
         if (ini.has(section)) {
           const auto& sec = ini.get(section);
@@ -491,13 +746,31 @@ namespace config
           if (sec.has("FlasksKeyword"))
             kw = sec.get("FlasksKeyword");
         }
-        settings.keyword = parse_keyword(kw);
+        defer_keyword(forms, kw, settings.keyword);
       };
 
       read_flask_full("FlasksHealth", flasks_health);
       read_flask_full("FlasksStamina", flasks_stamina);
       read_flask_full("FlasksMagick", flasks_magick);
 
+      // [FlasksCategory.<Name>], sized up front because the deferred forms point into the elements.
+      std::vector<std::string> category_sections;
+      for (const auto& [section, _] : ini) {
+        if (section.starts_with(kFlaskCategorySectionPrefix) && section.size() > kFlaskCategorySectionPrefix.size()) {
+          category_sections.push_back(section);
+        }
+      }
+      if (category_sections.size() > kMaxFlaskCategories) {
+        logger::warn("{} flask categories defined, only the first {} are used", category_sections.size(),
+                     kMaxFlaskCategories);
+        category_sections.resize(kMaxFlaskCategories);
+      }
+      categories.resize(category_sections.size());
+      for (std::size_t i = 0; i < category_sections.size(); ++i) {
+        categories[i].name = category_sections[i].substr(kFlaskCategorySectionPrefix.size());
+        read_flask_full(category_sections[i], categories[i]);
+      }
+
       // [PrismaWidget]
       if (ini.has("PrismaWidget")) {
         const auto& sec = ini.get("PrismaWidget");
@@ -519,6 +792,8 @@ namespace config
         if (sec.has("PrismaAnchorAllElements"))
           parse_bool(sec.get("PrismaAnchorAllElements"),
                      prisma_widget.anchor_all_elements);
+        if (sec.has("PrismaHideInMenus"))
+          parse_menu_list(sec.get("PrismaHideInMenus"), prisma_widget.hide_menus);
 
         auto read_prisma_flask = [&](const std::string& prefix,
                                      const std::string& type,
@@ -547,9 +822,156 @@ namespace config
         read_prisma_flask("PrismaFlasksOther", "Other", prisma_widget.other);
       }
 
+      return snapshot;
+    }
+
+    // Main thread only: resolves all collected form references in one pass.
+    void resolve_forms(config_snapshot& snapshot)
+    {
+      for (const auto& form : snapshot.forms) {
+        if (form.keyword) {
+          *form.keyword = parse_keyword(form.value);
+        }
+        if (form.sound) {
+          *form.sound = parse_sound_descriptor(form.value);
+        }
+      }
+      snapshot.forms.clear();
+    }
+
+    void apply(const config_snapshot& snapshot)
+    {
+      static_cast<config_values&>(*this) = snapshot.values;
+      hot_reload_enabled_.store(main.hot_reload, std::memory_order_release);
+      publish();
+    }
+
+    // Copies the editable values into a new snapshot and makes it the current one.
+    void publish()
+    {
+      std::lock_guard<std::mutex> lock(publish_mutex_);
+      // Actor state follows its category by name, it has to be in the new order before anyone reads it.
+      std::vector<std::string> category_names;
+      for (const auto& category : categories) {
+        category_names.push_back(category.name);
+      }
+      core::actors_cache::cache_data::get_singleton()->set_category_names(std::move(category_names));
+
+      const auto previous = published_.load(std::memory_order_acquire);
+      auto next = std::make_shared<settings_snapshot>();
+      next->version = previous ? previous->version + 1 : 1;
+      next->values = static_cast<const config_values&>(*this);
+      compile_keyword_masks(*next);
+      published_.store(std::move(next), std::memory_order_release);
+
+      const auto tracker = core::menu_tracker::menu_tracker::get_singleton();
+      tracker->configure(core::menu_tracker::menu_group::block_hotkeys, main.hotkey_blocking_menus);
+      tracker->configure(core::menu_tracker::menu_group::hide_widget, prisma_widget.hide_menus);
+      core::allocation_profiler::set_enabled(main.allocation_profiling);
+      core::telemetry::telemetry::get_singleton()->set_enabled(main.telemetry_export);
+    }
+
+    void watch(const std::stop_token& stop)
+    {
+      std::mutex wait_mutex;
+      std::condition_variable_any wait;
+      while (!stop.stop_requested()) {
+        {
+          std::unique_lock<std::mutex> lock(wait_mutex);
+          static_cast<void>(wait.wait_for(lock, stop, kWatchInterval, [] { return false; }));
+        }
+        if (stop.stop_requested() || !hot_reload_enabled_.load(std::memory_order_acquire)) {
+          continue;
+        }
+
+        const auto write_time = get_write_time();
+        if (!write_time || write_time->time_since_epoch().count() == known_write_time_.load(std::memory_order_acquire)) {
+          continue;
+        }
+        known_write_time_.store(write_time->time_since_epoch().count(), std::memory_order_release);
+
+        mINI::INIFile file(config_path_);
+        mINI::INIStructure ini;
+        if (!file.read(ini)) {
+          logger::warn("Configuration changed but could not be read, keeping current settings.");
+          continue;
+        }
+
+        auto snapshot = parse(ini);
+        {
+          std::lock_guard<std::mutex> lock(pending_mutex_);
+          pending_ = std::move(snapshot);
+        }
+        has_pending_.store(true, std::memory_order_release);
+        logger::info("Configuration file changed, applying on the next frame.");
+      }
+    }
+
+    void discard_pending()
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      pending_.reset();
+      has_pending_.store(false, std::memory_order_release);
+    }
+
+  public:
+    auto load() -> void
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      logger::info("Loading configuration");
+
+      mINI::INIFile file(config_path_);
+      mINI::INIStructure ini;
+
+      if (!file.read(ini)) {
+        logger::info("Configuration file not found, generating default.");
+        generate_default(file, ini);
+        remember_write_time();
+        return;
+      }
+
+      discard_pending();
+      remember_write_time();
+      auto snapshot = parse(ini);
+      resolve_forms(*snapshot);
+      apply(*snapshot);
+
       logger::info("Configuration loaded successfully.");
     }
 
+    [[nodiscard]] auto has_pending_reload() const -> bool
+    {
+      return has_pending_.load(std::memory_order_acquire);
+    }
+
+    // Call at a frame boundary on the main thread. Applies a snapshot the watcher parsed, if there is one.
+    // Returns true when settings changed.
+    auto apply_pending() -> bool
+    {
+      if (!has_pending_.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      std::unique_ptr<config_snapshot> snapshot;
+      {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        snapshot = std::move(pending_);
+        has_pending_.store(false, std::memory_order_release);
+      }
+      if (!snapshot) {
+        return false;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      resolve_forms(*snapshot);
+      apply(*snapshot);
+      logger::info("Configuration hot-reloaded.");
+      return true;
+    }
+
+  private:
+
     [[nodiscard]] auto try_parse_section_name(const std::string& line) const
       -> std::optional<std::string>
     {
@@ -698,7 +1120,7 @@ namespace config
       return true;
     }
 
-    auto save() -> void
+    void write_values(const config_values& values)
     {
       std::lock_guard<std::mutex> lock(mutex_);
 
@@ -710,7 +1132,7 @@ namespace config
       bool file_exists = file.read(ini);
       const auto original_ini = ini;
 
-      populate_ini(ini);
+      populate_ini(ini, values);
 
       bool success = false;
 
@@ -723,12 +1145,115 @@ namespace config
       }
 
       if (success) {
+        save_writes_.fetch_add(1, std::memory_order_relaxed);
+        remember_write_time();
         logger::info("Configuration saved.");
       }
       else {
         logger::error("Failed to save configuration.");
       }
     }
+
+    // Writes the published settings once the menu has been idle for kSaveDebounce, or right away on flush.
+    // Edits are published at the next frame, well inside the idle period, and flush_save() publishes first.
+    // Nothing is written when the thread is stopped, so edits not yet flushed by a save or by closing the menu
+    // are lost if the game exits.
+    void write_loop(const std::stop_token& stop)
+    {
+      std::unique_lock<std::mutex> lock(save_mutex_);
+      while (save_wait_.wait(lock, stop, [this] { return save_dirty_; })) {
+        while (!flush_requested_ && std::chrono::steady_clock::now() < last_change_ + kSaveDebounce) {
+          if (save_wait_.wait_until(lock, stop, last_change_ + kSaveDebounce, [this] { return flush_requested_; }) ||
+              stop.stop_requested()) {
+            break;
+          }
+        }
+        if (stop.stop_requested()) {
+          break;
+        }
+
+        save_dirty_ = false;
+        flush_requested_ = false;
+        lock.unlock();
+        write_values(snapshot()->values);
+        lock.lock();
+      }
+    }
+
+  public:
+    struct save_stats
+    {
+      std::uint64_t requested;
+      std::uint64_t written;
+    };
+
+    // Writes the current values synchronously.
+    auto save() -> void
+    {
+      save_requests_.fetch_add(1, std::memory_order_relaxed);
+      write_values(*this);
+    }
+
+    // Call after editing settings in place. Copies nothing: the edit reaches gameplay code with the next
+    // publish_pending(), and the writer thread saves that snapshot once edits stop, so dragging a slider costs
+    // one file write instead of one per frame.
+    auto mark_dirty() -> void
+    {
+      publish_requested_.store(true, std::memory_order_release);
+      save_requests_.fetch_add(1, std::memory_order_relaxed);
+      {
+        std::lock_guard<std::mutex> lock(save_mutex_);
+        save_dirty_ = true;
+        last_change_ = std::chrono::steady_clock::now();
+      }
+      save_wait_.notify_all();
+    }
+
+    // Main thread, once per frame: publishes the edits marked since the last call as a single snapshot.
+    auto publish_pending() -> void
+    {
+      if (publish_requested_.exchange(false, std::memory_order_acq_rel)) {
+        publish();
+      }
+    }
+
+    // Main thread. Writes pending changes without waiting for the idle period, on menu close and on game save.
+    auto flush_save() -> void
+    {
+      publish_pending();
+      {
+        std::lock_guard<std::mutex> lock(save_mutex_);
+        if (!save_dirty_) {
+          return;
+        }
+        flush_requested_ = true;
+      }
+      save_wait_.notify_all();
+    }
+
+    // Current settings for readers. Never null. Take it once per call and keep the returned pointer
+    // for as long as anything derived from it (settings pointers, keyword lists) is used.
+    [[nodiscard]] auto snapshot() const -> std::shared_ptr<const settings_snapshot>
+    {
+      return published_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] auto get_save_stats() const -> save_stats
+    {
+      return {save_requests_.load(std::memory_order_relaxed), save_writes_.load(std::memory_order_relaxed)};
+    }
   };
 
+  export auto current_snapshot() -> std::shared_ptr<const settings_snapshot>
+  {
+    return config_manager::get_singleton()->snapshot();
+  }
+
+  // Shares ownership of the snapshot the values belong to.
+  export auto current() -> std::shared_ptr<const config_values>
+  {
+    auto snapshot = current_snapshot();
+    return {snapshot, &snapshot->values};
+  }
+
 } // namespace config
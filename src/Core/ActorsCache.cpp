@@ -1,198 +1,811 @@
 module;
 
-#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
 #include "API/TrueFlasksAPI.h"
 
 export module TrueFlasks.Core.ActorsCache;
 
+import TrueFlasks.Core.Telemetry;
+import TrueFlasks.Core.FlaskTick;
+
 namespace core::actors_cache
 {
   export struct cache_data final
   {
-    struct actor_data final
+    // Fixed part of an actor's state: the four built-in flask types. Trivially copyable, written to the cosave as is.
+    struct actor_state
+    {
+      static constexpr auto FLASK_ARRAY_SIZE = flask_tick::kSlotCount;
+      static constexpr auto FLASK_TYPE_SIZE = flask_tick::kBuiltinTypeCount;
+      // Config-defined categories follow the built-in types, type index FLASK_TYPE_SIZE + category.
+      static constexpr auto FLASK_CATEGORY_MAX_SIZE = flask_tick::kCategoryMaxCount;
+
+      // The tick itself is plain arithmetic in TrueFlasks.Core.FlaskTick, so it can be measured off the game.
+      using delta_data = flask_tick::delta_data;
+      using flask_cooldown = flask_tick::flask_cooldown;
+
+      // 0 - Health, 1 - Stamina, 2 - Magick, 3 - Other
+      flask_cooldown flasks[FLASK_TYPE_SIZE][FLASK_ARRAY_SIZE];
+
+      float anti_spam_durations[FLASK_TYPE_SIZE]{0.f};
+      bool failed_drink_types[FLASK_TYPE_SIZE]{false, false, false, false};
+      int last_inventory_counts[FLASK_TYPE_SIZE]{-1, -1, -1, -1};
+      // Max slots last reported to event subscribers, -1 until the first event of the type.
+      int last_max_slots[FLASK_TYPE_SIZE]{-1, -1, -1, -1};
+
+      std::uint64_t last_tick{GetTickCount64()};
+      // Calendar hours at the last game time sync, negative until the first sync.
+      float last_game_hours{-1.f};
+      // Set when the actor comes back from the cold store, the next sync applies the missed time.
+      bool pending_catch_up{false};
+    };
+
+    struct actor_data final : actor_state
     {
-      struct delta_data final
+      using category_state = flask_tick::category_state;
+
+      // Contiguous table of the categories this actor has touched, grown on first use.
+      std::vector<category_state> categories;
+
+      [[nodiscard]] auto get_category(const int category) -> category_state*
       {
-        float delta;
-        float delta_health;
-        float delta_stamina;
-        float delta_magick;
-        float delta_other;
-        bool parallel_health;
-        bool parallel_stamina;
-        bool parallel_magick;
-        bool parallel_other;
-      };
+        if (category < 0 || category >= FLASK_CATEGORY_MAX_SIZE) {
+          return nullptr;
+        }
+        if (static_cast<std::size_t>(category) >= categories.size()) {
+          categories.resize(static_cast<std::size_t>(category) + 1);
+        }
+        return &categories[category];
+      }
 
-      struct flask_cooldown final
+      // Slots of a built-in type or a category by type index, nullptr if out of range.
+      [[nodiscard]] auto get_flasks(const int type) -> flask_cooldown*
       {
-        flask_cooldown() : cooldown_start(0.f), cooldown_current(0.f)
-        {
+        if (type >= 0 && type < FLASK_TYPE_SIZE) {
+          return flasks[type];
         }
+        const auto category = get_category(type - FLASK_TYPE_SIZE);
+        return category ? category->flasks : nullptr;
+      }
 
-        flask_cooldown(const float cooldown_start) : cooldown_start(cooldown_start), cooldown_current(cooldown_start)
-        {
+      [[nodiscard]] auto get_anti_spam_duration(const int type) -> float*
+      {
+        if (type >= 0 && type < FLASK_TYPE_SIZE) {
+          return &anti_spam_durations[type];
         }
+        const auto category = get_category(type - FLASK_TYPE_SIZE);
+        return category ? &category->anti_spam_duration : nullptr;
+      }
 
-        float cooldown_start;
-        float cooldown_current;
-      };
+      // Read-only lookup: nullptr for a category the actor never touched, nothing is allocated.
+      [[nodiscard]] auto find_flasks(const int type) const -> const flask_cooldown*
+      {
+        if (type >= 0 && type < FLASK_TYPE_SIZE) {
+          return flasks[type];
+        }
+        const auto category = type - FLASK_TYPE_SIZE;
+        if (category < 0 || static_cast<std::size_t>(category) >= categories.size()) {
+          return nullptr;
+        }
+        return categories[category].flasks;
+      }
 
-      static constexpr auto FLASK_ARRAY_SIZE = 99;
-      static constexpr auto FLASK_TYPE_SIZE = 4;
-      flask_cooldown flasks_health[FLASK_ARRAY_SIZE];
-      flask_cooldown flasks_magick[FLASK_ARRAY_SIZE];
-      flask_cooldown flasks_stamina[FLASK_ARRAY_SIZE];
-      flask_cooldown flasks_others[FLASK_ARRAY_SIZE];
-      
-      float anti_spam_durations[FLASK_TYPE_SIZE]{0.f};
-      // 0 - Health, 1 - Stamina, 2 - Magick, 3 - Other
-      bool failed_drink_types[FLASK_TYPE_SIZE]{false, false, false, false};
-      int last_inventory_counts[FLASK_TYPE_SIZE]{-1, -1, -1, -1};
+      [[nodiscard]] auto get_last_max_slots(const int type) -> int*
+      {
+        if (type >= 0 && type < FLASK_TYPE_SIZE) {
+          return &last_max_slots[type];
+        }
+        const auto category = get_category(type - FLASK_TYPE_SIZE);
+        return category ? &category->last_max_slots : nullptr;
+      }
 
-      std::uint64_t last_tick{GetTickCount64()};
+      void advance(const delta_data& delta_data, const bool carry_over)
+      {
+        flask_tick::advance(flasks, anti_spam_durations, categories, delta_data, carry_over);
+      }
 
       void update(const delta_data& delta_data)
       {
         last_tick = GetTickCount64();
-        for (const int i : std::views::iota(0, FLASK_TYPE_SIZE)) {
-          if (anti_spam_durations[i] > 0.f) {
-            anti_spam_durations[i] -= delta_data.delta;
-          }
-        }
+        advance(delta_data, false);
+      }
 
-        auto update_flasks = [](flask_cooldown* flasks, const float delta, const bool parallel) {
-          if (parallel) {
-            for (const int i : std::views::iota(0, FLASK_ARRAY_SIZE)) {
-              if (flasks[i].cooldown_current > 0.f) {
-                flasks[i].cooldown_current -= delta;
-                if (flasks[i].cooldown_current < 0.f) {
-                  flasks[i].cooldown_current = 0.f;
-                }
-              }
-            }
-          } else {
-            int min_index = -1;
-            for (const int i : std::views::iota(0, FLASK_ARRAY_SIZE)) {
-              if (flasks[i].cooldown_current > 0.f) {
-                if (min_index == -1 || flasks[i].cooldown_current < flasks[min_index].cooldown_current) {
-                  min_index = i;
-                }
-              }
-            }
-            if (min_index != -1) {
-              flasks[min_index].cooldown_current -= delta;
-              if (flasks[min_index].cooldown_current < 0.f) {
-                flasks[min_index].cooldown_current = 0.f;
-              }
-            }
-          }
-        };
+      // Applies time that passed without frame ticks (waiting, sleeping, fast travel) in one step.
+      void catch_up(const delta_data& delta_data)
+      {
+        advance(delta_data, true);
+      }
+    };
 
+    // Unloaded actor: only the slots that were still recharging and when it was last seen.
+    struct cold_actor_data final
+    {
+      struct cold_slot final
+      {
+        std::uint8_t type;
+        std::uint8_t index;
+        float cooldown_start;
+        float cooldown_current;
+      };
 
-        update_flasks(flasks_health, delta_data.delta_health, delta_data.parallel_health);
-        update_flasks(flasks_stamina, delta_data.delta_stamina, delta_data.parallel_stamina);
-        update_flasks(flasks_magick, delta_data.delta_magick, delta_data.parallel_magick);
-        update_flasks(flasks_others, delta_data.delta_other, delta_data.parallel_other);
-      }
+      float last_game_hours{-1.f};
+      std::vector<cold_slot> slots;
+    };
+
+    struct cache_stats final
+    {
+      std::size_t hot;
+      std::size_t cold;
+    };
+
+    // Block of the hot table. Slots are laid out back to back and never move, an actor keeps its address until it
+    // is collected and the slot is reused. A free slot has form id 0.
+    struct table_chunk final
+    {
+      static constexpr std::size_t SIZE = 64;
+
+      std::array<actor_data, SIZE> actors;
+      std::array<RE::FormID, SIZE> form_ids{};
+      // Frame tick recorded by the update hook, bit per slot, applied by the next sweep.
+      std::uint64_t seen_mask{0};
+      std::array<actor_data::delta_data, SIZE> deltas;
     };
 
   private:
-    std::map<RE::FormID, actor_data> actors_cache_;
+    // Hot actors in a dense table, the FormID index is only used to find an actor's slot.
+    std::vector<std::unique_ptr<table_chunk>> chunks_;
+    std::unordered_map<RE::FormID, std::uint32_t> index_;
+    std::vector<std::uint32_t> free_slots_;
+    // Slots handed out so far, free or not.
+    std::uint32_t slot_count_{0};
+    // Read without the lock to skip empty sweeps.
+    std::atomic<std::size_t> seen_count_{0};
+    // The player always has slot 0 of the first chunk, which is never freed, so the pointer is valid for the
+    // lifetime of the cache and reading through it needs neither the lock nor the index.
+    actor_data* player_{nullptr};
+    // Next slot checked by maintain().
+    std::uint32_t maintenance_cursor_{0};
+    std::unordered_map<RE::FormID, cold_actor_data> cold_cache_;
+    // Category state is stored by position; these are the category names in that order. Kept in step with the
+    // config by set_category_names() and written to the cosave, so state stays with its category by name when
+    // sections are reordered, added or removed.
+    std::vector<std::string> category_names_;
+    // Saved position to current position for the cosave being loaded, empty when it carries no names.
+    std::vector<int> load_category_map_;
     std::mutex mutex_;
     static constexpr uint64_t GARBAGE_TIME = 5000;
-    static constexpr uint32_t SERIALIZATION_VERSION = 1;
+    // Cold actors are dropped after three in-game days, any cooldown is long finished by then.
+    static constexpr float COLD_EXPIRY_GAME_HOURS = 72.f;
+    static constexpr RE::FormID PLAYER_FORM_ID = 0x14;
+    static constexpr uint32_t SERIALIZATION_VERSION = 5;
     static constexpr uint32_t LABEL = 'CDAD';
+    static constexpr uint32_t LABEL_COLD = 'CDCD';
+    static constexpr uint32_t LABEL_CATEGORIES = 'CDCN';
 
     [[nodiscard]] static auto is_garbage(const actor_data& data) -> bool
     {
       return (GetTickCount64() - data.last_tick) >= GARBAGE_TIME;
     }
 
+    [[nodiscard]] static auto get_game_hours() -> float
+    {
+      const auto calendar = RE::Calendar::GetSingleton();
+      return calendar ? calendar->GetHoursPassed() : -1.f;
+    }
+
+    [[nodiscard]] static auto demote(actor_data& data) -> cold_actor_data
+    {
+      cold_actor_data cold;
+      cold.last_game_hours = data.last_game_hours >= 0.f ? data.last_game_hours : get_game_hours();
+      const auto type_count = actor_data::FLASK_TYPE_SIZE + static_cast<int>(data.categories.size());
+      for (const int type : std::views::iota(0, type_count)) {
+        const auto flasks = data.get_flasks(type);
+        for (const int i : std::views::iota(0, actor_data::FLASK_ARRAY_SIZE)) {
+          if (flasks[i].cooldown_current > 0.f) {
+            cold.slots.push_back({static_cast<std::uint8_t>(type), static_cast<std::uint8_t>(i),
+                                  flasks[i].cooldown_start, flasks[i].cooldown_current});
+          }
+        }
+      }
+      return cold;
+    }
+
+    [[nodiscard]] static auto promote(const cold_actor_data& cold) -> actor_data
+    {
+      actor_data data;
+      for (const auto& slot : cold.slots) {
+        const auto flasks = data.get_flasks(slot.type);
+        if (!flasks || slot.index >= actor_data::FLASK_ARRAY_SIZE) {
+          continue;
+        }
+        flasks[slot.index].cooldown_start = slot.cooldown_start;
+        flasks[slot.index].cooldown_current = slot.cooldown_current;
+      }
+      data.last_game_hours = cold.last_game_hours;
+      data.pending_catch_up = cold.last_game_hours >= 0.f;
+      return data;
+    }
+
+    // For each category of from, its position in to, or -1 if to does not have it.
+    [[nodiscard]] static auto make_category_map(const std::span<const std::string> from,
+                                                const std::span<const std::string> to) -> std::vector<int>
+    {
+      std::vector<int> map(from.size(), -1);
+      for (std::size_t i = 0; i < from.size(); ++i) {
+        if (const auto it = std::ranges::find(to, from[i]); it != to.end()) {
+          map[i] = static_cast<int>(it - to.begin());
+        }
+      }
+      return map;
+    }
+
+    [[nodiscard]] static auto is_identity(const std::span<const int> map) -> bool
+    {
+      for (std::size_t i = 0; i < map.size(); ++i) {
+        if (map[i] != static_cast<int>(i)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Type index after a category move, -1 for a category that is gone. Built-in types stay.
+    [[nodiscard]] static auto remap_type(const int type, const std::span<const int> map) -> int
+    {
+      if (type < actor_data::FLASK_TYPE_SIZE) {
+        return type;
+      }
+      const auto category = static_cast<std::size_t>(type - actor_data::FLASK_TYPE_SIZE);
+      return category < map.size() && map[category] >= 0 ? actor_data::FLASK_TYPE_SIZE + map[category] : -1;
+    }
+
+    static void remap_categories(actor_data& data, const std::span<const int> map)
+    {
+      std::vector<actor_data::category_state> remapped;
+      for (std::size_t i = 0; i < data.categories.size() && i < map.size(); ++i) {
+        if (map[i] < 0) {
+          continue;
+        }
+        const auto target = static_cast<std::size_t>(map[i]);
+        if (target >= remapped.size()) {
+          remapped.resize(target + 1);
+        }
+        remapped[target] = data.categories[i];
+      }
+      data.categories = std::move(remapped);
+    }
+
+    static void remap_categories(cold_actor_data& cold, const std::span<const int> map)
+    {
+      std::erase_if(cold.slots, [map](auto& slot) {
+        const auto type = remap_type(slot.type, map);
+        slot.type = static_cast<std::uint8_t>(type);
+        return type < 0;
+      });
+    }
+
+    // A tick recorded before the move still carries deltas in the old category order.
+    static void remap_categories(actor_data::delta_data& delta, const std::span<const int> map)
+    {
+      auto remapped = delta;
+      remapped.category_count = 0;
+      const auto count = (std::min)(static_cast<std::size_t>((std::max)(delta.category_count, 0)), map.size());
+      for (std::size_t i = 0; i < count; ++i) {
+        if (map[i] < 0) {
+          continue;
+        }
+        const auto from = actor_data::FLASK_TYPE_SIZE + i;
+        const auto to = actor_data::FLASK_TYPE_SIZE + static_cast<std::size_t>(map[i]);
+        remapped.deltas[to] = delta.deltas[from];
+        remapped.parallel[to] = delta.parallel[from];
+        remapped.slot_limits[to] = delta.slot_limits[from];
+        remapped.category_count = (std::max)(remapped.category_count, map[i] + 1);
+      }
+      delta = remapped;
+    }
+
+    // Moves an actor that stopped updating to the cold store. Actors with nothing recharging are simply dropped.
+    // Returns true if the hot entry was removed.
+    auto collect_actor(const RE::FormID form_id, actor_data& data) -> bool
+    {
+      if (form_id == PLAYER_FORM_ID || !is_garbage(data)) {
+        return false;
+      }
+      auto cold = demote(data);
+      if (!cold.slots.empty()) {
+        cold_cache_.insert_or_assign(form_id, std::move(cold));
+      }
+      telemetry::telemetry::get_singleton()->add(telemetry::metric::cache_evictions);
+      return true;
+    }
+
+    auto expire_cold() -> void
+    {
+      if (const auto hours = get_game_hours(); hours >= 0.f) {
+        const auto expired = std::erase_if(cold_cache_, [hours](const auto& pair) -> bool {
+          const auto& [_, cold] = pair;
+          return cold.last_game_hours < 0.f || hours - cold.last_game_hours >= COLD_EXPIRY_GAME_HOURS ||
+                 hours < cold.last_game_hours;
+        });
+        if (expired > 0) {
+          telemetry::telemetry::get_singleton()->add(telemetry::metric::cold_expirations, expired);
+        }
+      }
+    }
+
+    [[nodiscard]] auto chunk_of(const std::uint32_t slot) const -> table_chunk&
+    {
+      return *chunks_[slot / table_chunk::SIZE];
+    }
+
+    // Claims a free slot for form_id, reusing collected slots before growing the table.
+    auto insert_slot(const RE::FormID form_id, actor_data data) -> std::uint32_t
+    {
+      std::uint32_t slot;
+      if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+      }
+      else {
+        slot = slot_count_++;
+        if (slot / table_chunk::SIZE >= chunks_.size()) {
+          chunks_.push_back(std::make_unique<table_chunk>());
+        }
+      }
+
+      auto& chunk = chunk_of(slot);
+      const auto offset = slot % table_chunk::SIZE;
+      chunk.form_ids[offset] = form_id;
+      chunk.actors[offset] = std::move(data);
+      index_.insert_or_assign(form_id, slot);
+      telemetry::telemetry::get_singleton()->record_max(telemetry::metric::cache_peak_actors,
+                                                        index_.size() + cold_cache_.size());
+      return slot;
+    }
+
+    auto release_slot(const std::uint32_t slot) -> void
+    {
+      auto& chunk = chunk_of(slot);
+      const auto offset = slot % table_chunk::SIZE;
+      const auto bit = std::uint64_t{1} << offset;
+      if (chunk.seen_mask & bit) {
+        chunk.seen_mask &= ~bit;
+        --seen_count_;
+      }
+      index_.erase(chunk.form_ids[offset]);
+      chunk.form_ids[offset] = 0;
+      chunk.actors[offset] = actor_data{};
+      free_slots_.push_back(slot);
+    }
+
+    // Calls fn(slot, form_id, data) for every occupied slot in table order.
+    template <typename Fn>
+    auto for_each_slot(Fn&& fn) -> void
+    {
+      for (std::uint32_t slot = 0; slot < slot_count_; ++slot) {
+        auto& chunk = chunk_of(slot);
+        const auto offset = slot % table_chunk::SIZE;
+        if (chunk.form_ids[offset] != 0) {
+          fn(slot, chunk.form_ids[offset], chunk.actors[offset]);
+        }
+      }
+    }
+
     auto garbage_collector() -> void
     {
-      std::erase_if(actors_cache_, [](auto& pair) -> bool {
-        const auto& [_, data] = pair;
-        return is_garbage(data);
+      for_each_slot([this](const std::uint32_t slot, const RE::FormID form_id, actor_data& data) {
+        if (collect_actor(form_id, data)) {
+          release_slot(slot);
+        }
       });
-      
+      expire_cold();
     }
 
-    auto load(const SKSE::SerializationInterface* a_interface) -> void
+    // Empties the table down to the first chunk, which is kept so the player's pinned slot never moves, and puts
+    // a fresh player state back in slot 0.
+    auto reset_table() -> void
+    {
+      if (chunks_.empty()) {
+        chunks_.push_back(std::make_unique<table_chunk>());
+      }
+      chunks_.resize(1);
+      auto& chunk = *chunks_.front();
+      chunk.form_ids.fill(0);
+      chunk.seen_mask = 0;
+      std::ranges::fill(chunk.actors, actor_data{});
+
+      index_.clear();
+      free_slots_.clear();
+      slot_count_ = 0;
+      seen_count_ = 0;
+      maintenance_cursor_ = 0;
+      insert_slot(PLAYER_FORM_ID, actor_data{});
+      player_ = std::addressof(chunk.actors[0]);
+    }
+
+    auto clear_unlocked() -> void
+    {
+      reset_table();
+      cold_cache_.clear();
+    }
+
+    auto revert() -> void
     {
       std::lock_guard<std::mutex> lock(mutex_);
+      clear_unlocked();
+      load_category_map_.clear();
+    }
+
+    // Category names as written by save(). The actor records follow it, so the map is ready when they are read.
+    auto load_category_names(const SKSE::SerializationInterface* a_interface) -> void
+    {
+      size_t count;
+      if (!a_interface->ReadRecordData(count) || count > actor_data::FLASK_CATEGORY_MAX_SIZE) {
+        return;
+      }
+
+      std::vector<std::string> names(count);
+      for (auto& name : names) {
+        size_t length;
+        if (!a_interface->ReadRecordData(length) || length > 256) {
+          return;
+        }
+        name.resize(length);
+        if (length > 0 && !a_interface->ReadRecordData(name.data(), static_cast<uint32_t>(length))) {
+          return;
+        }
+      }
+      load_category_map_ = make_category_map(names, category_names_);
+    }
+
+    // actor_state as cosaves before version 5 stored it: one array per built-in type, Magick before Stamina, and no
+    // categories. Version 2 added the game time sync, 3 the catch-up flag, 4 the last reported max slots.
+    struct legacy_flasks final
+    {
+      actor_data::flask_cooldown health[actor_data::FLASK_ARRAY_SIZE];
+      actor_data::flask_cooldown magick[actor_data::FLASK_ARRAY_SIZE];
+      actor_data::flask_cooldown stamina[actor_data::FLASK_ARRAY_SIZE];
+      actor_data::flask_cooldown others[actor_data::FLASK_ARRAY_SIZE];
+      float anti_spam_durations[actor_data::FLASK_TYPE_SIZE];
+      bool failed_drink_types[actor_data::FLASK_TYPE_SIZE];
+      int last_inventory_counts[actor_data::FLASK_TYPE_SIZE];
+    };
 
-      uint32_t type;
-      uint32_t version;
-      uint32_t length;
+    struct legacy_state_v1 final
+    {
+      legacy_flasks flasks;
+      std::uint64_t last_tick;
+    };
 
-      actors_cache_.clear();
+    struct legacy_state_v2 final
+    {
+      legacy_flasks flasks;
+      std::uint64_t last_tick;
+      float last_game_hours;
+    };
+
+    struct legacy_state_v3 final
+    {
+      legacy_flasks flasks;
+      std::uint64_t last_tick;
+      float last_game_hours;
+      bool pending_catch_up;
+    };
+
+    struct legacy_state_v4 final
+    {
+      legacy_flasks flasks;
+      int last_max_slots[actor_data::FLASK_TYPE_SIZE];
+      std::uint64_t last_tick;
+      float last_game_hours;
+      bool pending_catch_up;
+    };
+
+    static_assert(sizeof(legacy_state_v1) == 3216 && sizeof(legacy_state_v2) == 3224 &&
+                  sizeof(legacy_state_v3) == 3224 && sizeof(legacy_state_v4) == 3240);
+
+    template <typename Legacy>
+    [[nodiscard]] static auto from_legacy(const Legacy& legacy) -> actor_data
+    {
+      actor_data data;
+      std::ranges::copy(legacy.flasks.health, data.flasks[0]);
+      std::ranges::copy(legacy.flasks.stamina, data.flasks[1]);
+      std::ranges::copy(legacy.flasks.magick, data.flasks[2]);
+      std::ranges::copy(legacy.flasks.others, data.flasks[3]);
+      std::ranges::copy(legacy.flasks.anti_spam_durations, data.anti_spam_durations);
+      std::ranges::copy(legacy.flasks.failed_drink_types, data.failed_drink_types);
+      std::ranges::copy(legacy.flasks.last_inventory_counts, data.last_inventory_counts);
+      data.last_tick = legacy.last_tick;
+      if constexpr (requires { legacy.last_game_hours; }) {
+        data.last_game_hours = legacy.last_game_hours;
+      }
+      if constexpr (requires { legacy.pending_catch_up; }) {
+        data.pending_catch_up = legacy.pending_catch_up;
+      }
+      if constexpr (requires { legacy.last_max_slots; }) {
+        std::ranges::copy(legacy.last_max_slots, data.last_max_slots);
+      }
+      return data;
+    }
+
+    // Puts a loaded actor into the hot table, replacing the state of one already there.
+    auto store_loaded(const RE::FormID form_id, actor_data data) -> void
+    {
+      if (const auto it = index_.find(form_id); it != index_.end()) {
+        chunk_of(it->second).actors[it->second % table_chunk::SIZE] = std::move(data);
+        return;
+      }
+      insert_slot(form_id, std::move(data));
+    }
+
+    template <typename Legacy>
+    auto load_legacy_actors(const SKSE::SerializationInterface* a_interface, const uint32_t version) -> void
+    {
+      size_t size;
+      if (!a_interface->ReadRecordData(size)) {
+        return;
+      }
+
+      size_t migrated = 0;
+      for (size_t i = 0; i < size; ++i) {
+        RE::FormID saved_form_id;
+        Legacy legacy;
+        if (!a_interface->ReadRecordData(saved_form_id) || !a_interface->ReadRecordData(legacy)) {
+          break;
+        }
+
+        RE::FormID resolved_form_id;
+        if (!a_interface->ResolveFormID(saved_form_id, resolved_form_id)) {
+          continue;
+        }
+        store_loaded(resolved_form_id, from_legacy(legacy));
+        ++migrated;
+      }
+      logger::info("Migrated flask state of {} actor(s) from cosave version {}", migrated, version);
+    }
+
+    // Hot actor records written before the current version.
+    auto load_legacy_actors(const SKSE::SerializationInterface* a_interface, const uint32_t version) -> void
+    {
+      switch (version) {
+      case 1: load_legacy_actors<legacy_state_v1>(a_interface, version); return;
+      case 2: load_legacy_actors<legacy_state_v2>(a_interface, version); return;
+      case 3: load_legacy_actors<legacy_state_v3>(a_interface, version); return;
+      case 4: load_legacy_actors<legacy_state_v4>(a_interface, version); return;
+      default: logger::warn("Flask state of cosave version {} is not supported and was dropped", version);
+      }
+    }
+
+    // Reads one cosave record. Returns false if the record belongs to someone else.
+    auto load_record(const SKSE::SerializationInterface* a_interface, const uint32_t type) -> bool
+    {
+      if (type != LABEL && type != LABEL_COLD && type != LABEL_CATEGORIES) {
+        return false;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      uint32_t serialization_version;
+      if (!a_interface->ReadRecordData(serialization_version)) {
+        clear_unlocked();
+        return true;
+      }
+
+      if (type == LABEL && serialization_version < SERIALIZATION_VERSION) {
+        load_legacy_actors(a_interface, serialization_version);
+        return true;
+      }
+
+      // The cold store record kept its format since it came in with version 3.
+      if (serialization_version != SERIALIZATION_VERSION && !(type == LABEL_COLD && serialization_version >= 3)) {
+        logger::warn("Flask state record {:08X} of cosave version {} is not supported and was dropped", type,
+                     serialization_version);
+        return true;
+      }
+
+      if (type == LABEL_CATEGORIES) {
+        load_category_names(a_interface);
+        return true;
+      }
+
+      // Cosaves without category names were written with the current order.
+      const auto remap = !load_category_map_.empty() && !is_identity(load_category_map_);
+
+      size_t size;
+      if (!a_interface->ReadRecordData(size)) {
+        return true;
+      }
+
+      for (size_t i = 0; i < size; ++i) {
+        RE::FormID saved_form_id;
+        if (!a_interface->ReadRecordData(saved_form_id)) {
+          break;
+        }
 
-      while (a_interface->GetNextRecordInfo(type, version, length)) {
         if (type == LABEL) {
-          uint32_t serialization_version;
-          if (!a_interface->ReadRecordData(serialization_version)) {
-            actors_cache_.clear();
-            return;
+          actor_data data;
+          size_t categories_size;
+          if (!a_interface->ReadRecordData(static_cast<actor_state&>(data)) ||
+              !a_interface->ReadRecordData(categories_size)) {
+            break;
           }
-
-          if (serialization_version != SERIALIZATION_VERSION) {
-            return;
+          data.categories.resize((std::min)(categories_size, static_cast<size_t>(actor_data::FLASK_CATEGORY_MAX_SIZE)));
+          if (categories_size > data.categories.size()) {
+            break;
           }
-
-          size_t size;
-          if (!a_interface->ReadRecordData(size)) {
+          if (categories_size > 0 &&
+              !a_interface->ReadRecordData(data.categories.data(),
+                                           static_cast<uint32_t>(categories_size * sizeof(actor_data::category_state)))) {
             break;
           }
 
-          for (size_t i = 0; i < size; ++i) {
-            RE::FormID saved_form_id;
-            if (!a_interface->ReadRecordData(saved_form_id)) {
-              break;
-            }
-
-            actor_data data;
-            if (!a_interface->ReadRecordData(data)) {
-              break;
-            }
-            
-            RE::FormID resolved_form_id;
-            if (!a_interface->ResolveFormID(saved_form_id, resolved_form_id)) {
-              continue;
-            }
-            actors_cache_[resolved_form_id] = data;
+          if (remap) {
+            remap_categories(data, load_category_map_);
+          }
+
+          RE::FormID resolved_form_id;
+          if (!a_interface->ResolveFormID(saved_form_id, resolved_form_id)) {
+            continue;
           }
+          store_loaded(resolved_form_id, std::move(data));
+          continue;
         }
+
+        cold_actor_data cold;
+        size_t slots_size;
+        if (!a_interface->ReadRecordData(cold.last_game_hours) || !a_interface->ReadRecordData(slots_size)) {
+          break;
+        }
+        cold.slots.resize(slots_size);
+        if (slots_size > 0 &&
+            !a_interface->ReadRecordData(cold.slots.data(),
+                                         static_cast<uint32_t>(slots_size * sizeof(cold_actor_data::cold_slot)))) {
+          break;
+        }
+
+        if (remap) {
+          remap_categories(cold, load_category_map_);
+        }
+
+        RE::FormID resolved_form_id;
+        if (!a_interface->ResolveFormID(saved_form_id, resolved_form_id)) {
+          continue;
+        }
+        cold_cache_[resolved_form_id] = std::move(cold);
       }
+
+      return true;
     }
 
     auto save(SKSE::SerializationInterface* a_interface) -> void
     {
       std::lock_guard<std::mutex> lock(mutex_);
 
-      if (!a_interface->OpenRecord(LABEL, SERIALIZATION_VERSION)) {
+      garbage_collector();
+
+      // Written first so that loading knows the category order before it reads any actor.
+      if (!a_interface->OpenRecord(LABEL_CATEGORIES, SERIALIZATION_VERSION) ||
+          !a_interface->WriteRecordData(SERIALIZATION_VERSION) ||
+          !a_interface->WriteRecordData(category_names_.size())) {
         return;
       }
+      for (const auto& name : category_names_) {
+        if (!a_interface->WriteRecordData(name.size()) ||
+            (!name.empty() && !a_interface->WriteRecordData(name.data(), static_cast<uint32_t>(name.size())))) {
+          return;
+        }
+      }
 
-      garbage_collector();
+      if (!a_interface->OpenRecord(LABEL, SERIALIZATION_VERSION)) {
+        return;
+      }
 
       if (!a_interface->WriteRecordData(SERIALIZATION_VERSION)) {
         return;
       }
 
-      const size_t size = actors_cache_.size();
+      const size_t size = index_.size();
       if (!a_interface->WriteRecordData(size)) {
         return;
       }
-
-      for (const auto& [form_id, data] : actors_cache_) {
+      // Bytes written to both records, for telemetry.
+      std::size_t written = sizeof(SERIALIZATION_VERSION) + sizeof(size);
+
+      for (std::uint32_t slot = 0; slot < slot_count_; ++slot) {
+        const auto& chunk = chunk_of(slot);
+        const auto form_id = chunk.form_ids[slot % table_chunk::SIZE];
+        if (form_id == 0) {
+          continue;
+        }
+        const auto& data = chunk.actors[slot % table_chunk::SIZE];
         if (!a_interface->WriteRecordData(form_id)) {
           return;
         }
-        if (!a_interface->WriteRecordData(data)) {
+        const size_t categories_size = data.categories.size();
+        if (!a_interface->WriteRecordData(static_cast<const actor_state&>(data)) ||
+            !a_interface->WriteRecordData(categories_size)) {
+          return;
+        }
+        if (categories_size > 0 &&
+            !a_interface->WriteRecordData(data.categories.data(),
+                                          static_cast<uint32_t>(categories_size * sizeof(actor_data::category_state)))) {
           return;
         }
+        written += sizeof(form_id) + sizeof(actor_state) + sizeof(categories_size) +
+                   categories_size * sizeof(actor_data::category_state);
+      }
+
+      if (!a_interface->OpenRecord(LABEL_COLD, SERIALIZATION_VERSION)) {
+        return;
+      }
+
+      if (!a_interface->WriteRecordData(SERIALIZATION_VERSION)) {
+        return;
+      }
+
+      const size_t cold_size = cold_cache_.size();
+      if (!a_interface->WriteRecordData(cold_size)) {
+        return;
+      }
+      written += sizeof(SERIALIZATION_VERSION) + sizeof(cold_size);
+
+      for (const auto& [form_id, cold] : cold_cache_) {
+        const size_t slots_size = cold.slots.size();
+        if (!a_interface->WriteRecordData(form_id) || !a_interface->WriteRecordData(cold.last_game_hours) ||
+            !a_interface->WriteRecordData(slots_size)) {
+          return;
+        }
+        if (slots_size > 0 &&
+            !a_interface->WriteRecordData(cold.slots.data(),
+                                          static_cast<uint32_t>(slots_size * sizeof(cold_actor_data::cold_slot)))) {
+          return;
+        }
+        written += sizeof(form_id) + sizeof(cold.last_game_hours) + sizeof(slots_size) +
+                   slots_size * sizeof(cold_actor_data::cold_slot);
+      }
+      telemetry::telemetry::get_singleton()->record_last(telemetry::metric::cosave_bytes, written);
+    }
+
+    // The actor's slot, promoting it from the cold store or adding it if it has none yet.
+    auto get_or_add_slot_unlocked(const RE::FormID form_id) -> std::uint32_t
+    {
+      if (const auto it = index_.find(form_id); it != index_.end()) {
+        return it->second;
       }
+
+      if (const auto cold = cold_cache_.find(form_id); cold != cold_cache_.end()) {
+        const auto slot = insert_slot(form_id, promote(cold->second));
+        cold_cache_.erase(cold);
+        return slot;
+      }
+
+      return insert_slot(form_id, actor_data{});
+    }
+
+    auto get_or_add_unlocked(const RE::FormID form_id) -> actor_data&
+    {
+      const auto slot = get_or_add_slot_unlocked(form_id);
+      return chunk_of(slot).actors[slot % table_chunk::SIZE];
+    }
+
+    // Read path: the hot entry, or a cold actor's state unpacked into scratch, or nullptr for an actor without any
+    // state. Changes nothing in the cache; a cold actor only comes back when it updates or is written.
+    auto find_unlocked(const RE::FormID form_id, std::optional<actor_data>& scratch) const -> const actor_data*
+    {
+      if (const auto it = index_.find(form_id); it != index_.end()) {
+        return std::addressof(chunk_of(it->second).actors[it->second % table_chunk::SIZE]);
+      }
+      if (const auto cold = cold_cache_.find(form_id); cold != cold_cache_.end()) {
+        return std::addressof(scratch.emplace(promote(cold->second)));
+      }
+      return nullptr;
+    }
+
+    cache_data()
+    {
+      reset_table();
     }
 
   public:
@@ -202,10 +815,162 @@ namespace core::actors_cache
       return std::addressof(singleton);
     }
 
+    // The player's pinned entry, always present.
+    [[nodiscard]] auto get_player() const -> actor_data&
+    {
+      return *player_;
+    }
+
+    // Returns the hot entry, promoting the actor from the cold store if it was unloaded before.
     auto get_or_add(const RE::FormID form_id) -> actor_data&
     {
+      if (form_id == PLAYER_FORM_ID) {
+        return *player_;
+      }
       std::lock_guard<std::mutex> lock(mutex_);
-      return actors_cache_[form_id];
+      return get_or_add_unlocked(form_id);
+    }
+
+    // Read path: the actor's state or nullptr if it has none. Neither adds nor promotes an entry, so queries about
+    // actors that never used a flask cost no memory; a cold actor is read from scratch.
+    auto find(const RE::FormID form_id, std::optional<actor_data>& scratch) -> const actor_data*
+    {
+      if (form_id == PLAYER_FORM_ID) {
+        return player_;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      return find_unlocked(form_id, scratch);
+    }
+
+    // Whether the actor has state, hot or cold.
+    auto contains(const RE::FormID form_id) -> bool
+    {
+      if (form_id == PLAYER_FORM_ID) {
+        return true;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      return index_.contains(form_id) || cold_cache_.contains(form_id);
+    }
+
+    // Calls fn(index, actor, data) for every non-null actor under a single lock acquisition, data is nullptr for
+    // actors without state. Nothing is added or promoted. fn must not call back into the cache.
+    template <typename Fn>
+    auto for_each_actor(const std::span<RE::Actor* const> actors, Fn&& fn) -> void
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::optional<actor_data> scratch;
+      for (std::size_t i = 0; i < actors.size(); ++i) {
+        if (const auto actor = actors[i]) {
+          fn(i, actor, find_unlocked(actor->GetFormID(), scratch));
+        }
+      }
+    }
+
+    // Records the actor's frame tick for the next sweep. A tick already waiting absorbs the new one, so a second
+    // update before the sweep never forces the sweep early.
+    auto mark_seen(const RE::FormID form_id, const actor_data::delta_data& delta_data) -> void
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto slot = get_or_add_slot_unlocked(form_id);
+      auto& chunk = chunk_of(slot);
+      const auto offset = slot % table_chunk::SIZE;
+      const auto bit = std::uint64_t{1} << offset;
+      if (chunk.seen_mask & bit) {
+        flask_tick::accumulate(chunk.deltas[offset], delta_data);
+        return;
+      }
+      chunk.seen_mask |= bit;
+      chunk.deltas[offset] = delta_data;
+      ++seen_count_;
+    }
+
+    // Whether any actor was marked since the last sweep, without taking the lock.
+    [[nodiscard]] auto has_seen() const -> bool
+    {
+      return seen_count_.load(std::memory_order_acquire) != 0;
+    }
+
+    // Calls fn(chunks) with the cache lock held if any actor was marked since the last sweep, then clears the marks.
+    // fn walks each chunk's seen_mask in slot order and may hand chunks to other threads, but must not call back
+    // into the cache.
+    template <typename Fn>
+    auto sweep_seen(Fn&& fn) -> void
+    {
+      if (!has_seen()) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (seen_count_ == 0) {
+        return;
+      }
+      fn(std::span<const std::unique_ptr<table_chunk>>{chunks_});
+      for (const auto& chunk : chunks_) {
+        chunk->seen_mask = 0;
+      }
+      seen_count_ = 0;
+    }
+
+    // Round-robin garbage collection: checks up to max_actors table slots per call, continuing where the previous
+    // call stopped, so a crowded cell never pays for a full sweep in one frame. Each new pass also expires cold actors.
+    auto maintain(const std::size_t max_actors) -> void
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (slot_count_ == 0) {
+        expire_cold();
+        return;
+      }
+
+      for (std::size_t i = 0; i < max_actors; ++i) {
+        if (maintenance_cursor_ >= slot_count_) {
+          maintenance_cursor_ = 0;
+          expire_cold();
+        }
+
+        const auto slot = maintenance_cursor_++;
+        auto& chunk = chunk_of(slot);
+        const auto offset = slot % table_chunk::SIZE;
+        if (chunk.form_ids[offset] != 0 && collect_actor(chunk.form_ids[offset], chunk.actors[offset])) {
+          release_slot(slot);
+        }
+      }
+    }
+
+    // Called with the category names of every published config. When categories moved, were added or removed,
+    // every actor's category state, hot, cold and pending, moves along by name; state of removed ones is dropped.
+    auto set_category_names(std::vector<std::string> names) -> void
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (names == category_names_) {
+        return;
+      }
+
+      const auto map = make_category_map(category_names_, names);
+      category_names_ = std::move(names);
+      if (is_identity(map)) {
+        return;
+      }
+
+      for (const auto& chunk : chunks_) {
+        for (std::size_t offset = 0; offset < table_chunk::SIZE; ++offset) {
+          if (chunk->form_ids[offset] == 0) {
+            continue;
+          }
+          remap_categories(chunk->actors[offset], map);
+          if (chunk->seen_mask & std::uint64_t{1} << offset) {
+            remap_categories(chunk->deltas[offset], map);
+          }
+        }
+      }
+      for (auto& cold : cold_cache_ | std::views::values) {
+        remap_categories(cold, map);
+      }
+      logger::info("Flask categories changed, actor state moved to match");
+    }
+
+    auto get_stats() -> cache_stats
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return {index_.size(), cold_cache_.size()};
     }
 
     static auto skse_save_callback(SKSE::SerializationInterface* serialization_interface) -> void
@@ -213,9 +978,15 @@ namespace core::actors_cache
       get_singleton()->save(serialization_interface);
     }
 
-    static auto skse_load_callback(SKSE::SerializationInterface* serialization_interface) -> void
+    static auto skse_revert_callback(SKSE::SerializationInterface*) -> void
+    {
+      get_singleton()->revert();
+    }
+
+    // The cosave is shared with other modules, the caller walks the records and offers each one here.
+    static auto skse_load_record(const SKSE::SerializationInterface* serialization_interface, const uint32_t type) -> bool
     {
-      get_singleton()->load(serialization_interface);
+      return get_singleton()->load_record(serialization_interface, type);
     }
   };
 }
@@ -0,0 +1,139 @@
+export module TrueFlasks.Core.AllocationProfiler;
+
+namespace core::allocation_profiler
+{
+  // Code paths allocations are charged to. The path marks itself with a site_scope, anything unmarked is other.
+  export enum class alloc_site : std::uint8_t
+  {
+    other = 0,
+    actor_update,
+    actor_flush,
+    prisma_widget,
+    flask_ui,
+    inventory_deposit,
+    actor_maintenance,
+    api_dispatch,
+    input,
+    container_event,
+    count
+  };
+
+  constexpr auto kSiteCount = static_cast<std::size_t>(alloc_site::count);
+
+  constexpr std::array<std::string_view, kSiteCount> kSiteNames{
+    "Other", "Actor update", "Actor tick flush", "Prisma widget", "Flask glow and caps", "Inventory deposit",
+    "Actor maintenance", "API event dispatch", "Input", "Container change"};
+
+  export struct site_stats final
+  {
+    std::string_view name;
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+  };
+
+  export struct profiler_stats final
+  {
+    bool enabled;
+    // Allocations on the marked sites during the last frame, and the most seen in one frame.
+    std::uint64_t last_frame;
+    std::uint64_t peak_frame;
+    std::vector<site_stats> sites;
+  };
+
+  struct site_counters final
+  {
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0};
+  };
+
+  // Plain globals rather than a singleton: record_allocation runs inside operator new, possibly before any
+  // dynamic initialization, so everything here is constant initialized and never allocates.
+  constinit std::atomic<bool> g_enabled{false};
+  constinit thread_local alloc_site g_current_site{alloc_site::other};
+  constinit std::array<site_counters, kSiteCount> g_sites{};
+  constinit std::atomic<std::uint64_t> g_frame_allocations{0};
+  constinit std::atomic<std::uint64_t> g_last_frame{0};
+  constinit std::atomic<std::uint64_t> g_peak_frame{0};
+
+  // Called by the global operator new. A relaxed load when profiling is off.
+  export void record_allocation(const std::size_t bytes) noexcept
+  {
+    if (!g_enabled.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    const auto site = g_current_site;
+    auto& counters = g_sites[static_cast<std::size_t>(site)];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (site != alloc_site::other) {
+      g_frame_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Charges the allocations made on this thread to site until the scope ends. Scopes nest.
+  export class site_scope final
+  {
+  private:
+    alloc_site previous_;
+
+  public:
+    explicit site_scope(const alloc_site site) noexcept : previous_(std::exchange(g_current_site, site))
+    {
+    }
+
+    ~site_scope()
+    {
+      g_current_site = previous_;
+    }
+
+    site_scope(const site_scope&) = delete;
+    auto operator=(const site_scope&) -> site_scope& = delete;
+  };
+
+  // Turning profiling on starts the counts over.
+  export void set_enabled(const bool enabled)
+  {
+    if (g_enabled.load(std::memory_order_acquire) == enabled) {
+      return;
+    }
+
+    if (enabled) {
+      for (auto& counters : g_sites) {
+        counters.allocations.store(0, std::memory_order_relaxed);
+        counters.bytes.store(0, std::memory_order_relaxed);
+      }
+      g_frame_allocations.store(0, std::memory_order_relaxed);
+      g_last_frame.store(0, std::memory_order_relaxed);
+      g_peak_frame.store(0, std::memory_order_relaxed);
+    }
+    g_enabled.store(enabled, std::memory_order_release);
+    logger::info("Allocation profiling {}", enabled ? "enabled" : "disabled");
+  }
+
+  // Main thread, once per frame: closes the frame's count.
+  export void on_frame() noexcept
+  {
+    if (!g_enabled.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    const auto count = g_frame_allocations.exchange(0, std::memory_order_relaxed);
+    g_last_frame.store(count, std::memory_order_relaxed);
+    if (count > g_peak_frame.load(std::memory_order_relaxed)) {
+      g_peak_frame.store(count, std::memory_order_relaxed);
+    }
+  }
+
+  export auto get_stats() -> profiler_stats
+  {
+    profiler_stats stats{g_enabled.load(std::memory_order_acquire), g_last_frame.load(std::memory_order_relaxed),
+                         g_peak_frame.load(std::memory_order_relaxed), {}};
+    stats.sites.reserve(kSiteCount);
+    for (std::size_t i = 0; i < kSiteCount; ++i) {
+      stats.sites.push_back({kSiteNames[i], g_sites[i].allocations.load(std::memory_order_relaxed),
+                             g_sites[i].bytes.load(std::memory_order_relaxed)});
+    }
+    return stats;
+  }
+}
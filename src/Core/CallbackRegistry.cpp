@@ -0,0 +1,126 @@
+export module TrueFlasks.Core.CallbackRegistry;
+
+namespace core::callback_registry
+{
+  // Per-plugin callbacks with copy-on-write publication. Writers copy the current list, change the copy and
+  // publish it with one atomic store; readers load the pointer and iterate without locking or allocating.
+  // Replaced lists are retired instead of freed, because a reader on another thread may still be iterating them.
+  // Readers announce themselves in a counter around every access; reclaim() frees the retired lists once it sees
+  // no reader inside, which is then provably none that could hold one of them.
+  export template <typename Callback>
+  class registry final
+  {
+  public:
+    struct entry final
+    {
+      SKSE::PluginHandle plugin_handle;
+      Callback callback;
+    };
+
+    using snapshot_type = std::vector<entry>;
+
+    registry() : owned_(std::make_unique<const snapshot_type>())
+    {
+      current_.store(owned_.get());
+    }
+
+    registry(const registry&) = delete;
+    auto operator=(const registry&) -> registry& = delete;
+
+    // Returns false if the plugin already has a callback registered.
+    auto add(const SKSE::PluginHandle plugin_handle, Callback callback) -> bool
+    {
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      const auto& current = *current_.load(std::memory_order_acquire);
+      if (std::ranges::any_of(current, [plugin_handle](const entry& e) { return e.plugin_handle == plugin_handle; })) {
+        return false;
+      }
+
+      auto next = std::make_unique<snapshot_type>(current);
+      next->push_back({plugin_handle, std::move(callback)});
+      publish(std::move(next));
+      return true;
+    }
+
+    // Returns false if the plugin had no callback registered.
+    auto remove(const SKSE::PluginHandle plugin_handle) -> bool
+    {
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      const auto& current = *current_.load(std::memory_order_acquire);
+      auto next = std::make_unique<snapshot_type>();
+      next->reserve(current.size());
+      std::ranges::copy_if(current, std::back_inserter(*next),
+                           [plugin_handle](const entry& e) { return e.plugin_handle != plugin_handle; });
+      if (next->size() == current.size()) {
+        return false;
+      }
+
+      publish(std::move(next));
+      return true;
+    }
+
+    [[nodiscard]] auto empty() const -> bool
+    {
+      const read_scope scope(readers_);
+      return current_.load()->empty();
+    }
+
+    template <typename... Args>
+    auto invoke_all(Args&&... args) const -> void
+    {
+      const read_scope scope(readers_);
+      for (const auto& e : *current_.load()) {
+        e.callback(args...);
+      }
+    }
+
+    // Frees the retired lists if no reader is inside the registry. Called after every change and at the main
+    // thread's frame end; gives up rather than wait when a writer holds the lock.
+    auto reclaim() -> void
+    {
+      std::unique_lock<std::mutex> lock(write_mutex_, std::try_to_lock);
+      if (lock.owns_lock()) {
+        reclaim_locked();
+      }
+    }
+
+  private:
+    // A reader that loaded a list before it was replaced entered before the replacing store, so while it is
+    // inside, the count a later reclaim() reads is not zero. Sequentially consistent throughout for that reason.
+    struct read_scope final
+    {
+      std::atomic<std::size_t>& readers;
+
+      explicit read_scope(std::atomic<std::size_t>& readers) : readers(readers)
+      {
+        readers.fetch_add(1);
+      }
+
+      ~read_scope()
+      {
+        readers.fetch_sub(1);
+      }
+    };
+
+    auto publish(std::unique_ptr<snapshot_type> next) -> void
+    {
+      retired_.push_back(std::move(owned_));
+      owned_ = std::move(next);
+      current_.store(owned_.get());
+      reclaim_locked();
+    }
+
+    auto reclaim_locked() -> void
+    {
+      if (!retired_.empty() && readers_.load() == 0) {
+        retired_.clear();
+      }
+    }
+
+    std::unique_ptr<const snapshot_type> owned_;
+    std::atomic<const snapshot_type*> current_{nullptr};
+    mutable std::atomic<std::size_t> readers_{0};
+    std::vector<std::unique_ptr<const snapshot_type>> retired_;
+    std::mutex write_mutex_;
+  };
+}
@@ -0,0 +1,71 @@
+module;
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <vector>
+
+export module TrueFlasks.Core.DepositPlan;
+
+namespace core::deposit_plan
+{
+  // Same order as config::inventory_select_mode.
+  export enum class select_order : std::uint8_t
+  {
+    weakest_first = 0,
+    strongest_first = 1,
+    first_found = 2
+  };
+
+  export template <typename Potion>
+  struct candidate
+  {
+    Potion potion;
+    int count;
+    int restore_count;
+  };
+
+  export template <typename Potion>
+  struct step
+  {
+    Potion potion;
+    int potions_used;
+    int slots_restored;
+  };
+
+  // Plans what the old one-potion-at-a-time loop did: take the best ranked potion, restore up to its restore
+  // count, repeat until the slots are full or a potion restores nothing. Candidates are in first found order; the
+  // sort is stable, so ties keep the first found potion just like the ranking does. The plan uses the candidates'
+  // memory.
+  export template <typename Potion>
+  auto plan(std::pmr::vector<candidate<Potion>> candidates, int missing_slots, const select_order order)
+    -> std::pmr::vector<step<Potion>>
+  {
+    if (order == select_order::weakest_first) {
+      std::ranges::stable_sort(candidates, std::ranges::less{}, &candidate<Potion>::restore_count);
+    }
+    else if (order == select_order::strongest_first) {
+      std::ranges::stable_sort(candidates, std::ranges::greater{}, &candidate<Potion>::restore_count);
+    }
+
+    std::pmr::vector<step<Potion>> result(candidates.get_allocator().resource());
+    for (const auto& candidate : candidates) {
+      if (missing_slots <= 0) {
+        break;
+      }
+      if (candidate.count <= 0) {
+        continue;
+      }
+      if (candidate.restore_count <= 0) {
+        break;
+      }
+      const auto needed = (missing_slots + candidate.restore_count - 1) / candidate.restore_count;
+      const auto used = (std::min)(candidate.count, needed);
+      const auto restored = (std::min)(missing_slots, used * candidate.restore_count);
+      result.push_back({candidate.potion, used, restored});
+      missing_slots -= restored;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,128 @@
+module;
+
+#include <algorithm>
+#include <cstdint>
+#include <ranges>
+#include <span>
+
+export module TrueFlasks.Core.FlaskTick;
+
+namespace core::flask_tick
+{
+  export constexpr int kSlotCount = 99;
+  export constexpr int kBuiltinTypeCount = 4;
+  // Config-defined categories follow the built-in types, type index kBuiltinTypeCount + category.
+  export constexpr int kCategoryMaxCount = 60;
+  export constexpr int kTypeMaxCount = kBuiltinTypeCount + kCategoryMaxCount;
+
+  export struct flask_cooldown final
+  {
+    flask_cooldown() : cooldown_start(0.f), cooldown_current(0.f)
+    {
+    }
+
+    flask_cooldown(const float cooldown_start) : cooldown_start(cooldown_start), cooldown_current(cooldown_start)
+    {
+    }
+
+    float cooldown_start;
+    float cooldown_current;
+  };
+
+  export struct delta_data final
+  {
+    float delta;
+    // Indexed by type: 0 - Health, 1 - Stamina, 2 - Magick, 3 - Other, then one entry per category.
+    float deltas[kTypeMaxCount];
+    bool parallel[kTypeMaxCount];
+    // Slots that count for SlotReady, taken on the game thread when the tick is recorded. 0 without subscribers.
+    std::uint8_t slot_limits[kTypeMaxCount];
+    int category_count;
+  };
+
+  // Folds a second frame tick into one still waiting for the sweep, so an actor updated twice in a frame advances
+  // by both deltas in one step. Flags and slot limits follow the newer tick.
+  export void accumulate(delta_data& pending, const delta_data& next)
+  {
+    pending.delta += next.delta;
+    for (const int i : std::views::iota(0, kTypeMaxCount)) {
+      pending.deltas[i] += next.deltas[i];
+      pending.parallel[i] = next.parallel[i];
+      pending.slot_limits[i] = next.slot_limits[i];
+    }
+    pending.category_count = next.category_count;
+  }
+
+  // One config-defined category: its own slots, anti-spam timer and last reported cap.
+  export struct category_state final
+  {
+    flask_cooldown flasks[kSlotCount];
+    float anti_spam_duration{0.f};
+    int last_max_slots{-1};
+  };
+
+  // Sequential cooldowns only advance the nearest slot. A frame tick drops the leftover time,
+  // a catch-up carries it over to the next nearest slot as many small frames would.
+  export void advance_flasks(flask_cooldown* flasks, const float delta, const bool parallel, const bool carry_over)
+  {
+    if (parallel) {
+      for (const int i : std::views::iota(0, kSlotCount)) {
+        if (flasks[i].cooldown_current > 0.f) {
+          flasks[i].cooldown_current -= delta;
+          if (flasks[i].cooldown_current < 0.f) {
+            flasks[i].cooldown_current = 0.f;
+          }
+        }
+      }
+      return;
+    }
+
+    auto remaining = delta;
+    while (remaining > 0.f) {
+      int min_index = -1;
+      for (const int i : std::views::iota(0, kSlotCount)) {
+        if (flasks[i].cooldown_current > 0.f) {
+          if (min_index == -1 || flasks[i].cooldown_current < flasks[min_index].cooldown_current) {
+            min_index = i;
+          }
+        }
+      }
+      if (min_index == -1) {
+        return;
+      }
+
+      const auto step = (std::min)(remaining, flasks[min_index].cooldown_current);
+      flasks[min_index].cooldown_current -= step;
+      if (!carry_over) {
+        return;
+      }
+      remaining -= step;
+    }
+  }
+
+  // One actor's tick. The built-in types have a compile-time count and fixed arrays, so their loop stays as tight
+  // as before; categories follow in one loop over the table. Categories past delta_data.category_count are left
+  // alone.
+  export void advance(flask_cooldown (&flasks)[kBuiltinTypeCount][kSlotCount],
+                      float (&anti_spam_durations)[kBuiltinTypeCount], const std::span<category_state> categories,
+                      const delta_data& delta_data, const bool carry_over)
+  {
+    for (const int i : std::views::iota(0, kBuiltinTypeCount)) {
+      if (anti_spam_durations[i] > 0.f) {
+        anti_spam_durations[i] -= delta_data.delta;
+      }
+      advance_flasks(flasks[i], delta_data.deltas[i], delta_data.parallel[i], carry_over);
+    }
+
+    const auto category_count =
+      (std::min)(categories.size(), static_cast<std::size_t>((std::max)(delta_data.category_count, 0)));
+    for (std::size_t i = 0; i < category_count; ++i) {
+      auto& category = categories[i];
+      if (category.anti_spam_duration > 0.f) {
+        category.anti_spam_duration -= delta_data.delta;
+      }
+      advance_flasks(category.flasks, delta_data.deltas[kBuiltinTypeCount + i],
+                     delta_data.parallel[kBuiltinTypeCount + i], carry_over);
+    }
+  }
+}
@@ -0,0 +1,84 @@
+module;
+
+#include <memory_resource>
+
+export module TrueFlasks.Core.FrameArena;
+
+namespace core::frame_arena
+{
+  // Memory for containers that do not outlive the frame they are built in. Allocating only bumps a pointer into
+  // a fixed buffer and freeing does nothing; the player update hands the whole buffer back at the end of the
+  // frame. Only the thread that resets the arena gets it, every other thread gets the default heap, so callers
+  // on the pool workers or the Papyrus threads need no special casing.
+  export class frame_arena final
+  {
+  private:
+    static constexpr std::size_t kCapacity = 64 * 1024;
+
+    // Takes what does not fit into the buffer from the heap and counts it, so a frame that outgrows kCapacity
+    // shows up in the diagnostics.
+    class overflow_resource final : public std::pmr::memory_resource
+    {
+    public:
+      std::atomic<std::uint64_t> allocations{0};
+      std::atomic<std::uint64_t> bytes{0};
+
+    private:
+      auto do_allocate(const std::size_t size, const std::size_t alignment) -> void* override
+      {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+      }
+
+      void do_deallocate(void* pointer, const std::size_t size, const std::size_t alignment) override
+      {
+        std::pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+      }
+
+      [[nodiscard]] auto do_is_equal(const memory_resource& other) const noexcept -> bool override
+      {
+        return this == &other;
+      }
+    };
+
+    std::unique_ptr<std::byte[]> buffer_{std::make_unique<std::byte[]>(kCapacity)};
+    overflow_resource overflow_;
+    std::pmr::monotonic_buffer_resource arena_{buffer_.get(), kCapacity, &overflow_};
+    std::atomic<std::thread::id> owner_{};
+
+  public:
+    struct overflow_stats final
+    {
+      std::uint64_t allocations;
+      std::uint64_t bytes;
+    };
+
+    static auto get_singleton() -> frame_arena*
+    {
+      static frame_arena singleton;
+      return std::addressof(singleton);
+    }
+
+    // The arena on the frame thread, the default heap anywhere else.
+    [[nodiscard]] auto resource() -> std::pmr::memory_resource*
+    {
+      if (owner_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        return &arena_;
+      }
+      return std::pmr::get_default_resource();
+    }
+
+    // End of frame. Everything taken from the arena since the last reset must be gone by now.
+    void reset()
+    {
+      owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+      arena_.release();
+    }
+
+    [[nodiscard]] auto get_overflow_stats() const -> overflow_stats
+    {
+      return {overflow_.allocations.load(std::memory_order_relaxed), overflow_.bytes.load(std::memory_order_relaxed)};
+    }
+  };
+}
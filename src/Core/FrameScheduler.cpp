@@ -0,0 +1,111 @@
+export module TrueFlasks.Core.FrameScheduler;
+
+import TrueFlasks.Core.HooksCtx;
+
+namespace core::frame_scheduler
+{
+  export using task_fn = std::function<void(const hooks_ctx::on_actor_update&)>;
+
+  export struct task_stats final
+  {
+    std::string name;
+    float period;
+    float budget_ms;
+    float last_cost_ms;
+    float max_cost_ms;
+    std::uint64_t runs;
+    // Runs that took longer than the task's budget.
+    std::uint64_t overruns;
+    // Frames the task was due but waited because the frame budget was used up.
+    std::uint64_t deferrals;
+  };
+
+  // Periodic work driven by the player update. Each task runs every period seconds, shifted by its phase so tasks
+  // with the same period do not land on the same frame. Due tasks run round-robin until the frame budget is used
+  // up, the rest stay due and go first on the next frame. Main thread only, except get_stats().
+  export class frame_scheduler final
+  {
+  private:
+    static constexpr float kFrameBudgetMs = 1.0f;
+
+    struct task final
+    {
+      task_fn fn;
+      // Seconds until the task is due, negative while it is due.
+      float countdown;
+      task_stats stats;
+    };
+
+    std::vector<task> tasks_;
+    std::size_t next_task_{0};
+    mutable std::mutex stats_mutex_;
+    std::vector<task_stats> stats_;
+
+  public:
+    static auto get_singleton() -> frame_scheduler*
+    {
+      static frame_scheduler singleton;
+      return std::addressof(singleton);
+    }
+
+    // period and phase are in seconds, budget_ms is the cost above which a run counts as an overrun.
+    void add_task(std::string name, const float period, const float phase, const float budget_ms, task_fn fn)
+    {
+      tasks_.push_back({std::move(fn), period + phase, {std::move(name), period, budget_ms, 0.f, 0.f, 0, 0, 0}});
+    }
+
+    void tick(const hooks_ctx::on_actor_update& ctx, const float delta)
+    {
+      for (auto& task : tasks_) {
+        task.countdown -= delta;
+      }
+
+      float spent_ms = 0.f;
+      const auto count = tasks_.size();
+      for (std::size_t visited = 0; visited < count; ++visited) {
+        const auto index = (next_task_ + visited) % count;
+        auto& task = tasks_[index];
+        if (task.countdown > 0.f) {
+          continue;
+        }
+
+        // At least one task runs per frame, so a single expensive task cannot starve.
+        if (spent_ms >= kFrameBudgetMs) {
+          task.stats.deferrals++;
+          continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        task.fn(ctx);
+        const auto cost_ms =
+          std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        spent_ms += cost_ms;
+        // A long hitch does not queue up several runs, the task runs once and then waits a full period.
+        task.countdown += task.stats.period;
+        if (task.countdown <= 0.f) {
+          task.countdown = task.stats.period;
+        }
+        task.stats.runs++;
+        task.stats.last_cost_ms = cost_ms;
+        task.stats.max_cost_ms = (std::max)(task.stats.max_cost_ms, cost_ms);
+        if (cost_ms > task.stats.budget_ms) {
+          task.stats.overruns++;
+        }
+        next_task_ = (index + 1) % count;
+      }
+
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      stats_.resize(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        stats_[i] = tasks_[i].stats;
+      }
+    }
+
+    [[nodiscard]] auto get_stats() const -> std::vector<task_stats>
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      return stats_;
+    }
+  };
+}
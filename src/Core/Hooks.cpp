@@ -3,9 +3,19 @@
 import TrueFlasks.Core.HooksCtx;
 import TrueFlasks.Features.TrueFlasks;
 import TrueFlasks.UI.Prisma;
+import TrueFlasks.API.ModAPI;
+import TrueFlasks.Config;
+import TrueFlasks.Core.ActorsCache;
+import TrueFlasks.Core.FrameScheduler;
+import TrueFlasks.Core.FrameArena;
+import TrueFlasks.Core.AllocationProfiler;
+import TrueFlasks.Core.Telemetry;
 
 namespace core::hooks
 {
+  using allocation_profiler::alloc_site;
+  using allocation_profiler::site_scope;
+
   template<typename T>
   auto write_call(SKSE::Trampoline& trampoline, const uintptr_t src, T& func, REL::Relocation<T>& func_original,
                   const char* label) -> void
@@ -37,6 +47,7 @@ namespace core::hooks
 
     static auto on_update(hooks_ctx::on_actor_update& ctx) -> void
     {
+      site_scope site(alloc_site::actor_update);
       features::true_flasks::update(ctx);
     }
 
@@ -46,8 +57,11 @@ namespace core::hooks
         return on_update_character_original(character, delta);
       }
 
-      auto ctx = hooks_ctx::on_actor_update{character, last_player_delta};
-      on_update(ctx);
+      {
+        telemetry::hook_timer timer(telemetry::hook::actor_update);
+        auto ctx = hooks_ctx::on_actor_update{character, last_player_delta};
+        on_update(ctx);
+      }
 
       return on_update_character_original(character, delta);
     }
@@ -59,27 +73,44 @@ namespace core::hooks
       if (!character || !delta) {
         return on_update_player_character_original(character, delta);
       }
-      
+
+      telemetry::hook_timer timer(telemetry::hook::player_update);
+
+      // Effect-derived flask values cached during the previous frame are recomputed on first use from here on.
+      features::true_flasks::begin_frame();
+
+      // Settings changed on disk are swapped in here, before anything reads them this frame.
+      const auto config = config::config_manager::get_singleton();
+      if (config->has_pending_reload()) {
+        const auto previous_prisma_enabled = config->prisma_widget.enable;
+        if (config->apply_pending()) {
+          ui::prisma::on_config_reloaded(previous_prisma_enabled);
+        }
+      }
+
       auto ctx = hooks_ctx::on_actor_update{character, last_player_delta};
-      
-      // Push all flask data, but only every 0.1 s
-      static float delta_counter = 0.f;
-      static float delta_counter_1s = 0.f;
-      delta_counter += delta;
-      delta_counter_1s += delta;
-      if (delta_counter >= 0.1f) {
-        delta_counter = 0.f;
-        ui::prisma::update(ctx);
-        features::true_flasks::update_ui(ctx);
+      on_update(ctx);
+
+      // Frame boundary: every actor tick queued since the last player update runs as one batch,
+      // before the scheduled tasks below read the slots.
+      {
+        site_scope site(alloc_site::actor_flush);
+        features::true_flasks::flush_actor_ticks();
       }
-      
-      if (delta_counter_1s >= 1.f) {
-        delta_counter_1s = 0.f;
-        features::true_flasks::update_1s(ctx);
+      frame_scheduler::frame_scheduler::get_singleton()->tick(ctx, delta);
+
+      // Flask events queued since the last frame go out to API subscribers in one batch.
+      {
+        site_scope site(alloc_site::api_dispatch);
+        api::mod_api::dispatch_flask_events();
       }
+      api::mod_api::reclaim_callbacks();
+
+      // Frame end: whatever this frame's work took from the arena is handed back in one go.
+      frame_arena::frame_arena::get_singleton()->reset();
+      allocation_profiler::on_frame();
+      timer.stop();
 
-      on_update(ctx);
-      
       return on_update_player_character_original(character, delta);
     }
 
@@ -87,6 +118,7 @@ namespace core::hooks
     static auto on_drink_potion(RE::Character* character, RE::AlchemyItem* potion,
                                 RE::ExtraDataList* extra_list) -> bool
     {
+      telemetry::hook_timer timer(telemetry::hook::drink_potion);
       auto ctx = hooks_ctx::on_actor_drink_potion{character, potion, extra_list};
       return features::true_flasks::drink_potion(ctx);
     }
@@ -112,6 +144,12 @@ namespace core::hooks
       return on_drink_potion(character, potion, extra_list) && on_drink_potion_player_character_original(
                character, potion, extra_list);
     }
+
+    static auto on_remove_item(hooks_ctx::on_actor_remove_item& ctx) -> void
+    {
+      telemetry::hook_timer timer(telemetry::hook::remove_item);
+      features::true_flasks::remove_item(ctx);
+    }
   
   static auto on_remove_item_character(RE::Character* actor, RE::ObjectRefHandle* ret_handle, RE::TESBoundObject* item, std::int32_t count, RE::ITEM_REMOVE_REASON reason, RE::ExtraDataList* extra_list, RE::TESObjectREFR* move_to_ref, const RE::NiPoint3* drop_loc, const RE::NiPoint3* rotate) -> RE::ObjectRefHandle*
   {
@@ -125,7 +163,7 @@ namespace core::hooks
         .rotate = rotate
       };
       
-      features::true_flasks::remove_item(ctx);
+      on_remove_item(ctx);
 
       return on_remove_item_character_original(actor, ret_handle, item, count, reason, extra_list, move_to_ref, drop_loc, rotate);
   }
@@ -142,7 +180,7 @@ namespace core::hooks
         .rotate = rotate
       };
 
-      features::true_flasks::remove_item(ctx);
+      on_remove_item(ctx);
 
       return on_remove_item_player_character_original(actor, ret_handle, item, ctx.count, reason, extra_list, move_to_ref, drop_loc, rotate);
   }
@@ -185,8 +223,33 @@ namespace core::hooks
     }
   };
 
+  // Periodic player work. Phases put tasks of the same period on different frames.
+  auto register_frame_tasks() -> void
+  {
+    const auto scheduler = frame_scheduler::frame_scheduler::get_singleton();
+    scheduler->add_task("Prisma widget", 0.1f, 0.f, 0.5f, [](const hooks_ctx::on_actor_update& ctx) {
+      site_scope site(alloc_site::prisma_widget);
+      ui::prisma::update(ctx);
+    });
+    scheduler->add_task("Flask glow and caps", 0.1f, 0.05f, 0.25f, [](const hooks_ctx::on_actor_update& ctx) {
+      site_scope site(alloc_site::flask_ui);
+      features::true_flasks::update_ui(ctx);
+    });
+    scheduler->add_task("Inventory deposit", 1.f, 0.025f, 0.5f, [](const hooks_ctx::on_actor_update& ctx) {
+      site_scope site(alloc_site::inventory_deposit);
+      features::true_flasks::update_1s(ctx);
+    });
+    // A few actors per run instead of the whole cache once a second.
+    scheduler->add_task("Actor maintenance", 0.1f, 0.075f, 0.25f, [](const hooks_ctx::on_actor_update&) {
+      site_scope site(alloc_site::actor_maintenance);
+      actors_cache::cache_data::get_singleton()->maintain(16);
+    });
+  }
+
   export auto install_hooks() -> void
   {
+    register_frame_tasks();
+
     auto& trampoline = SKSE::GetTrampoline();
     trampoline.create(512);
 
@@ -0,0 +1,74 @@
+module;
+
+#include <cstdint>
+#include <memory_resource>
+#include <ranges>
+#include <span>
+#include <unordered_map>
+
+export module TrueFlasks.Core.ItemCounts;
+
+namespace core::item_counts
+{
+  // Totals per object of a container, merged from its base entries and its inventory changes. Base entries have
+  // to be added before the changes: a change is a delta on top of them, or the full count for a leveled entry.
+  export template <typename Object>
+  class item_totals final
+  {
+  private:
+    std::pmr::unordered_map<Object, std::int32_t> totals_;
+
+  public:
+    explicit item_totals(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : totals_(resource)
+    {
+    }
+
+    void add_base(const Object object, const std::int32_t count)
+    {
+      totals_[object] += count;
+    }
+
+    void add_change(const Object object, const std::int32_t count, const bool leveled)
+    {
+      if (leveled) {
+        totals_[object] = count;
+      }
+      else {
+        totals_[object] += count;
+      }
+    }
+
+    [[nodiscard]] auto get() const -> const std::pmr::unordered_map<Object, std::int32_t>&
+    {
+      return totals_;
+    }
+
+    // Sum of the positive totals.
+    [[nodiscard]] auto count() const -> std::int32_t
+    {
+      std::int32_t result = 0;
+      for (const auto total : totals_ | std::views::values) {
+        result += total > 0 ? total : 0;
+      }
+      return result;
+    }
+  };
+
+  // One walk over the totals for several keys: counts[i] receives the total of every object with a positive
+  // count for which matches(object, i) holds. An object matching several keys counts towards each of them.
+  export template <typename Object, typename Matches>
+  void count_per_key(const item_totals<Object>& totals, const std::span<std::int32_t> counts, Matches&& matches)
+  {
+    std::ranges::fill(counts, 0);
+    for (const auto& [object, count] : totals.get()) {
+      if (count <= 0) {
+        continue;
+      }
+      for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (matches(object, i)) {
+          counts[i] += count;
+        }
+      }
+    }
+  }
+}
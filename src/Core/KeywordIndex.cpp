@@ -0,0 +1,145 @@
+module;
+
+#include <bitset>
+#include <shared_mutex>
+#include <unordered_map>
+
+export module TrueFlasks.Core.KeywordIndex;
+
+namespace core::keyword_index
+{
+  // Room for every keyword the settings can configure, see the static_assert in Config.
+  export constexpr std::size_t kMaxIndexedKeywords = 384;
+  export using keyword_mask = std::bitset<kMaxIndexedKeywords>;
+
+  // Bits of the configured keywords, assigned once when a settings snapshot is compiled and read-only after.
+  export class keyword_bits final
+  {
+  private:
+    std::unordered_map<const RE::BGSKeyword*, std::uint16_t> bits_;
+
+  public:
+    // The keyword's bit as a mask, assigning the next free bit on first sight. Null gives an empty mask, which
+    // matches nothing.
+    auto add(const RE::BGSKeyword* keyword) -> keyword_mask
+    {
+      keyword_mask mask;
+      if (!keyword) {
+        return mask;
+      }
+      auto it = bits_.find(keyword);
+      if (it == bits_.end()) {
+        if (bits_.size() >= kMaxIndexedKeywords) {
+          logger::warn("Keyword index holds {} keywords, the rest never match", kMaxIndexedKeywords);
+          return mask;
+        }
+        it = bits_.emplace(keyword, static_cast<std::uint16_t>(bits_.size())).first;
+      }
+      mask.set(it->second);
+      return mask;
+    }
+
+    [[nodiscard]] auto mask_of(const RE::BGSKeywordForm* form) const -> keyword_mask
+    {
+      keyword_mask mask;
+      if (!form || !form->keywords) {
+        return mask;
+      }
+      for (std::uint32_t i = 0; i < form->numKeywords; ++i) {
+        if (const auto it = bits_.find(form->keywords[i]); it != bits_.end()) {
+          mask.set(it->second);
+        }
+      }
+      return mask;
+    }
+  };
+
+  export struct potion_masks final
+  {
+    // The potion's own keywords.
+    keyword_mask own;
+    // Own keywords plus those of its effects.
+    keyword_mask with_effects;
+  };
+
+  // Keeps the keyword masks of potions and magic effects under the bits of the newest settings snapshot, so a
+  // keyword test on a hot path is one cached lookup and a mask AND instead of a scan over the form's keyword
+  // array. Player-made potions are dynamic forms whose IDs get reused, their masks are built on every call.
+  // Safe on any thread.
+  export class keyword_index final
+  {
+  private:
+    std::shared_mutex mutex_;
+    std::uint64_t version_{0};
+    std::unordered_map<RE::FormID, potion_masks> potions_;
+    std::unordered_map<RE::FormID, keyword_mask> effects_;
+
+    // Cached lookup for the given snapshot version. A newer version drops every cached mask, a reader still on an
+    // older one gets its masks built without touching the cache.
+    template <typename Map, typename Build>
+    auto get_cached(Map& map, const RE::FormID form_id, const std::uint64_t version, Build&& build)
+      -> typename Map::mapped_type
+    {
+      {
+        std::shared_lock lock(mutex_);
+        if (version_ == version) {
+          if (const auto it = map.find(form_id); it != map.end()) {
+            return it->second;
+          }
+        }
+        else if (version_ > version) {
+          return build();
+        }
+      }
+
+      const auto masks = build();
+      std::unique_lock lock(mutex_);
+      if (version_ < version) {
+        potions_.clear();
+        effects_.clear();
+        version_ = version;
+      }
+      if (version_ == version) {
+        map.emplace(form_id, masks);
+      }
+      return masks;
+    }
+
+  public:
+    static auto get_singleton() -> keyword_index*
+    {
+      static keyword_index singleton;
+      return std::addressof(singleton);
+    }
+
+    [[nodiscard]] auto potion_masks_of(const RE::AlchemyItem* potion, const keyword_bits& bits,
+                                       const std::uint64_t version) -> potion_masks
+    {
+      if (!potion) {
+        return {};
+      }
+
+      const auto build = [potion, &bits] {
+        potion_masks masks;
+        masks.own = bits.mask_of(potion);
+        masks.with_effects = masks.own;
+        for (const auto effect : potion->effects) {
+          if (effect && effect->baseEffect) {
+            masks.with_effects |= bits.mask_of(effect->baseEffect);
+          }
+        }
+        return masks;
+      };
+      return potion->IsDynamicForm() ? build() : get_cached(potions_, potion->GetFormID(), version, build);
+    }
+
+    [[nodiscard]] auto effect_mask_of(const RE::EffectSetting* effect, const keyword_bits& bits,
+                                      const std::uint64_t version) -> keyword_mask
+    {
+      if (!effect) {
+        return {};
+      }
+      return get_cached(effects_, effect->GetFormID(), version, [effect, &bits] { return bits.mask_of(effect); });
+    }
+  };
+}
@@ -0,0 +1,121 @@
+export module TrueFlasks.Core.MenuTracker;
+
+namespace core::menu_tracker
+{
+  export enum class menu_group : std::uint8_t
+  {
+    // Menus that hide the Prisma widget.
+    hide_widget = 0,
+    // Menus that ignore flask hotkeys.
+    block_hotkeys = 1
+  };
+
+  // Open state of the configured menus as one bit per menu, updated from MenuOpenCloseEvent deltas.
+  // Asking whether any menu of a group is open is a single mask test instead of one UI lookup per name.
+  export class menu_tracker final
+  {
+  private:
+    static constexpr std::size_t kMaxMenus = 64;
+    static constexpr std::size_t kGroupCount = 2;
+
+    // Written by configure() on any thread, picked up by the main thread on its next call.
+    std::mutex pending_mutex_;
+    std::array<std::vector<std::string>, kGroupCount> pending_;
+    std::atomic<bool> dirty_{false};
+
+    // Main thread only. A menu's bit is its index in names_.
+    std::vector<RE::BSFixedString> names_;
+    std::array<std::uint64_t, kGroupCount> masks_{};
+    std::uint64_t open_{0};
+
+    [[nodiscard]] auto find(const RE::BSFixedString& name) const -> int
+    {
+      for (std::size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] == name) {
+          return static_cast<int>(i);
+        }
+      }
+      return -1;
+    }
+
+    // Assigns bits for the new menu lists and asks the UI once for the menus that are already open.
+    void refresh()
+    {
+      if (!dirty_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+      }
+
+      std::array<std::vector<std::string>, kGroupCount> groups;
+      {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        groups = pending_;
+      }
+
+      names_.clear();
+      masks_.fill(0);
+      open_ = 0;
+      for (std::size_t group = 0; group < kGroupCount; ++group) {
+        for (const auto& name : groups[group]) {
+          const RE::BSFixedString menu_name{name};
+          auto index = find(menu_name);
+          if (index < 0) {
+            if (names_.size() >= kMaxMenus) {
+              logger::warn("Menu tracker supports {} menus, ignoring {}", kMaxMenus, name);
+              continue;
+            }
+            index = static_cast<int>(names_.size());
+            names_.push_back(menu_name);
+          }
+          masks_[group] |= std::uint64_t{1} << index;
+        }
+      }
+
+      if (const auto ui = RE::UI::GetSingleton()) {
+        for (std::size_t i = 0; i < names_.size(); ++i) {
+          if (ui->IsMenuOpen(names_[i])) {
+            open_ |= std::uint64_t{1} << i;
+          }
+        }
+      }
+    }
+
+  public:
+    static auto get_singleton() -> menu_tracker*
+    {
+      static menu_tracker singleton;
+      return std::addressof(singleton);
+    }
+
+    // Replaces the menus of a group. Unchanged lists cost nothing, so it is safe to call on every settings publish.
+    void configure(const menu_group group, const std::vector<std::string>& names)
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      auto& pending = pending_[static_cast<std::size_t>(group)];
+      if (pending == names) {
+        return;
+      }
+      pending = names;
+      dirty_.store(true, std::memory_order_release);
+    }
+
+    // Main thread only.
+    void on_menu_event(const RE::BSFixedString& menu_name, const bool is_opening)
+    {
+      refresh();
+      const auto index = find(menu_name);
+      if (index < 0) {
+        return;
+      }
+
+      const auto bit = std::uint64_t{1} << index;
+      open_ = is_opening ? open_ | bit : open_ & ~bit;
+    }
+
+    // Main thread only.
+    [[nodiscard]] auto is_any_open(const menu_group group) -> bool
+    {
+      refresh();
+      return (open_ & masks_[static_cast<std::size_t>(group)]) != 0;
+    }
+  };
+}
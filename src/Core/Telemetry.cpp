@@ -0,0 +1,376 @@
+module;
+
+#include <bit>
+#include <fstream>
+
+export module TrueFlasks.Core.Telemetry;
+
+namespace core::telemetry
+{
+  // Hooks whose calls are counted and timed. Only the plugin's own work is timed, not the original function.
+  export enum class hook : std::uint8_t
+  {
+    actor_update = 0,
+    player_update,
+    drink_potion,
+    remove_item,
+    input_event,
+    container_event,
+    count
+  };
+
+  export enum class metric : std::uint8_t
+  {
+    // Most actors held by the cache at once, hot and cold together.
+    cache_peak_actors = 0,
+    // Hot actors dropped or moved to the cold store by the garbage collector.
+    cache_evictions,
+    // Cold actors that expired.
+    cold_expirations,
+    inventory_scans,
+    effect_visits,
+    widget_interop_calls,
+    widget_bytes_sent,
+    // Size of the actor records in the last cosave.
+    cosave_bytes,
+    count
+  };
+
+  constexpr auto kHookCount = static_cast<std::size_t>(hook::count);
+  constexpr auto kMetricCount = static_cast<std::size_t>(metric::count);
+
+  constexpr std::array<std::string_view, kHookCount> kHookNames{"actor_update", "player_update", "drink_potion",
+                                                                "remove_item",  "input_event",   "container_event"};
+  constexpr std::array<std::string_view, kMetricCount> kMetricNames{
+    "cache_peak_actors", "cache_evictions",      "cold_expirations",  "inventory_scans",
+    "effect_visits",     "widget_interop_calls", "widget_bytes_sent", "cosave_bytes"};
+
+  // Opt-in session telemetry. The game threads only bump atomic counters; on every save, and when telemetry is
+  // turned off, the writer thread appends the session's totals so far as one row to a CSV in the SKSE log
+  // directory, so runs of different modlists or releases can be compared offline. At exit from a game (a new game,
+  // a load, or Quit to the main menu) the row is written on the game thread before the game moves on: SKSE has no
+  // shutdown message and the writer thread is already gone when static destructors run.
+  export class telemetry final
+  {
+  private:
+    // Hook durations go into power-of-two buckets of nanoseconds, percentiles are read off the bucket bounds.
+    static constexpr std::size_t kBucketCount = 40;
+
+    struct hook_counters final
+    {
+      std::atomic<std::uint64_t> max_ns{0};
+      std::array<std::atomic<std::uint64_t>, kBucketCount> buckets{};
+    };
+
+    struct hook_row final
+    {
+      std::uint64_t calls;
+      double p50_us;
+      double p95_us;
+      double p99_us;
+      double max_us;
+    };
+
+    struct session_row final
+    {
+      std::string session;
+      std::string reason;
+      double session_seconds;
+      std::array<hook_row, kHookCount> hooks;
+      std::array<std::uint64_t, kMetricCount> metrics;
+    };
+
+    std::atomic<bool> enabled_{false};
+    std::array<hook_counters, kHookCount> hooks_{};
+    std::array<std::atomic<std::uint64_t>, kMetricCount> metrics_{};
+    std::chrono::steady_clock::time_point session_start_{std::chrono::steady_clock::now()};
+    std::string session_id_;
+
+    std::mutex mutex_;
+    // Keeps rows from the writer thread and from export_now() from interleaving in the file.
+    std::mutex file_mutex_;
+    std::condition_variable_any wake_;
+    std::vector<session_row> pending_;
+    // Player updates counted at the last export_now() row.
+    std::uint64_t exit_player_updates_{0};
+
+    // Declared last so the thread is joined before the state it uses is destroyed.
+    std::jthread writer_;
+
+    [[nodiscard]] static auto percentile_us(const std::array<std::uint64_t, kBucketCount>& buckets,
+                                            const std::uint64_t calls, const double fraction) -> double
+    {
+      if (calls == 0) {
+        return 0.0;
+      }
+      const auto rank = static_cast<std::uint64_t>(std::ceil(static_cast<double>(calls) * fraction));
+      std::uint64_t seen = 0;
+      for (std::size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+          return static_cast<double>(std::uint64_t{1} << i) / 1000.0;
+        }
+      }
+      return static_cast<double>(std::uint64_t{1} << (kBucketCount - 1)) / 1000.0;
+    }
+
+    // Caller holds mutex_.
+    [[nodiscard]] auto snapshot(std::string reason) const -> session_row
+    {
+      session_row row{session_id_, std::move(reason),
+                      std::chrono::duration<double>(std::chrono::steady_clock::now() - session_start_).count(), {}, {}};
+      for (std::size_t i = 0; i < kHookCount; ++i) {
+        const auto& counters = hooks_[i];
+        std::array<std::uint64_t, kBucketCount> buckets{};
+        std::uint64_t calls = 0;
+        for (std::size_t b = 0; b < kBucketCount; ++b) {
+          buckets[b] = counters.buckets[b].load(std::memory_order_relaxed);
+          calls += buckets[b];
+        }
+        row.hooks[i] = {calls, percentile_us(buckets, calls, 0.50), percentile_us(buckets, calls, 0.95),
+                        percentile_us(buckets, calls, 0.99),
+                        static_cast<double>(counters.max_ns.load(std::memory_order_relaxed)) / 1000.0};
+      }
+      for (std::size_t i = 0; i < kMetricCount; ++i) {
+        row.metrics[i] = metrics_[i].load(std::memory_order_relaxed);
+      }
+      return row;
+    }
+
+    [[nodiscard]] static auto make_header() -> std::string
+    {
+      std::string header = "session,reason,session_seconds,plugin_version,game_version,plugins,light_plugins";
+      for (const auto name : kHookNames) {
+        header += std::format(",{0}_calls,{0}_p50_us,{0}_p95_us,{0}_p99_us,{0}_max_us", name);
+      }
+      for (const auto name : kMetricNames) {
+        header += std::format(",{}", name);
+      }
+      return header;
+    }
+
+    // Writer thread; the game thread only takes the snapshot.
+    [[nodiscard]] static auto format_row(const session_row& row) -> std::string
+    {
+      std::uint32_t plugins = 0;
+      std::uint32_t light_plugins = 0;
+      if (const auto data_handler = RE::TESDataHandler::GetSingleton()) {
+        plugins = data_handler->GetLoadedModCount();
+        light_plugins = data_handler->GetLoadedLightModCount();
+      }
+
+      auto line = std::format("{},{},{:.1f},{},{},{},{}", row.session, row.reason, row.session_seconds,
+                              SKSE::PluginDeclaration::GetSingleton()->GetVersion().string("."),
+                              REL::Module::get().version().string("."), plugins, light_plugins);
+      for (const auto& hook : row.hooks) {
+        line += std::format(",{},{:.3f},{:.3f},{:.3f},{:.3f}", hook.calls, hook.p50_us, hook.p95_us, hook.p99_us,
+                            hook.max_us);
+      }
+      for (const auto value : row.metrics) {
+        line += std::format(",{}", value);
+      }
+      return line;
+    }
+
+    void append(const std::span<const session_row> rows)
+    {
+      if (rows.empty()) {
+        return;
+      }
+      std::lock_guard<std::mutex> file_lock(file_mutex_);
+
+      const auto directory = SKSE::log::log_directory();
+      if (!directory) {
+        logger::warn("SKSE log directory not available, telemetry not written");
+        return;
+      }
+
+      const auto path = *directory / "TrueFlasksNG-telemetry.csv";
+      std::error_code ec;
+      const auto is_new = !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+      std::ofstream file(path, std::ios::app);
+      if (!file) {
+        logger::error("Failed to open {} for telemetry", path.string());
+        return;
+      }
+      if (is_new) {
+        file << make_header() << '\n';
+      }
+      for (const auto& row : rows) {
+        file << format_row(row) << '\n';
+      }
+    }
+
+    // Queued rows are written as they come.
+    void write_loop(const std::stop_token& stop)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (wake_.wait(lock, stop, [this] { return !pending_.empty(); })) {
+        auto rows = std::move(pending_);
+        pending_.clear();
+        lock.unlock();
+        append(rows);
+        lock.lock();
+      }
+    }
+
+    telemetry() = default;
+
+  public:
+    static auto get_singleton() -> telemetry*
+    {
+      static telemetry singleton;
+      return std::addressof(singleton);
+    }
+
+    telemetry(const telemetry&) = delete;
+    auto operator=(const telemetry&) -> telemetry& = delete;
+
+    [[nodiscard]] auto is_enabled() const -> bool
+    {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // Turning telemetry on starts a new session. Turning it off queues the session's final row, keeps the thread
+    // and stops counting.
+    void set_enabled(const bool enabled)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (enabled_.load(std::memory_order_relaxed) == enabled) {
+        return;
+      }
+
+      if (enabled) {
+        for (auto& counters : hooks_) {
+          counters.max_ns.store(0, std::memory_order_relaxed);
+          for (auto& bucket : counters.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+          }
+        }
+        for (auto& value : metrics_) {
+          value.store(0, std::memory_order_relaxed);
+        }
+        session_start_ = std::chrono::steady_clock::now();
+        exit_player_updates_ = 0;
+        session_id_ = std::format("{:%Y-%m-%dT%H:%M:%S}", std::chrono::floor<std::chrono::seconds>(
+                                                            std::chrono::system_clock::now()));
+        if (!writer_.joinable()) {
+          writer_ = std::jthread([this](const std::stop_token& stop) { write_loop(stop); });
+        }
+      }
+      else {
+        pending_.push_back(snapshot("disabled"));
+      }
+      enabled_.store(enabled, std::memory_order_release);
+      lock.unlock();
+      wake_.notify_all();
+      logger::info("Session telemetry {}", enabled ? "enabled" : "disabled");
+    }
+
+    void record_hook(const hook which, const std::uint64_t ns)
+    {
+      auto& counters = hooks_[static_cast<std::size_t>(which)];
+      counters.buckets[(std::min)(static_cast<std::size_t>(std::bit_width(ns)), kBucketCount - 1)].fetch_add(
+        1, std::memory_order_relaxed);
+      auto max = counters.max_ns.load(std::memory_order_relaxed);
+      while (ns > max && !counters.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+      }
+    }
+
+    void add(const metric which, const std::uint64_t value = 1)
+    {
+      if (is_enabled()) {
+        metrics_[static_cast<std::size_t>(which)].fetch_add(value, std::memory_order_relaxed);
+      }
+    }
+
+    void record_max(const metric which, const std::uint64_t value)
+    {
+      if (!is_enabled()) {
+        return;
+      }
+      auto& target = metrics_[static_cast<std::size_t>(which)];
+      auto current = target.load(std::memory_order_relaxed);
+      while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+      }
+    }
+
+    void record_last(const metric which, const std::uint64_t value)
+    {
+      if (is_enabled()) {
+        metrics_[static_cast<std::size_t>(which)].store(value, std::memory_order_relaxed);
+      }
+    }
+
+    // Queues a row with the totals so far. Called on save; the file is written by the writer thread.
+    void request_export(std::string reason)
+    {
+      if (!is_enabled()) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(snapshot(std::move(reason)));
+      }
+      wake_.notify_all();
+    }
+
+    // Exit from a game, on the game thread: writes the rows still queued and one with the totals so far before
+    // returning, so the row is on disk whatever happens to the process next. Without a player update since the last
+    // such row there is nothing new to report: the main menu at startup, or a load right after Quit.
+    void export_now(std::string reason)
+    {
+      if (!is_enabled()) {
+        return;
+      }
+      std::vector<session_row> rows;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rows = std::move(pending_);
+        pending_.clear();
+        auto row = snapshot(std::move(reason));
+        const auto player_updates = row.hooks[static_cast<std::size_t>(hook::player_update)].calls;
+        if (player_updates != exit_player_updates_) {
+          exit_player_updates_ = player_updates;
+          rows.push_back(std::move(row));
+        }
+      }
+      append(rows);
+    }
+  };
+
+  // Times one hook call from construction to stop() or destruction. Reads no clock while telemetry is off.
+  export class hook_timer final
+  {
+  private:
+    hook hook_;
+    std::optional<std::chrono::steady_clock::time_point> start_;
+
+  public:
+    explicit hook_timer(const hook which) : hook_(which)
+    {
+      if (telemetry::get_singleton()->is_enabled()) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~hook_timer()
+    {
+      stop();
+    }
+
+    hook_timer(const hook_timer&) = delete;
+    auto operator=(const hook_timer&) -> hook_timer& = delete;
+
+    void stop()
+    {
+      if (!start_) {
+        return;
+      }
+      const auto elapsed = std::chrono::steady_clock::now() - *start_;
+      start_.reset();
+      telemetry::get_singleton()->record_hook(
+        hook_, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+  };
+}
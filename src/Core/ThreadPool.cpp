@@ -0,0 +1,222 @@
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+export module TrueFlasks.Core.ThreadPool;
+
+namespace core::thread_pool
+{
+  // Small pool for data-parallel jobs. parallel_for splits [0, count) into chunks and gives every participant,
+  // the calling thread included, an equal share. A participant that runs out steals single chunks from the back
+  // of the others' shares, so a few expensive items do not leave the other threads idle. The caller returns once
+  // every chunk is done. One job at a time; concurrent callers are serialized.
+  export class thread_pool final
+  {
+  private:
+    static constexpr std::size_t kMaxWorkers = 3;
+
+    using chunk_fn = void (*)(void*, std::size_t, std::size_t);
+
+    // A participant's remaining chunks as [begin, end) packed into one word, so popping the front and stealing
+    // the back are both a single compare-exchange.
+    struct alignas(64) lane final
+    {
+      std::atomic<std::uint64_t> range{0};
+    };
+
+    static constexpr auto pack(const std::uint32_t begin, const std::uint32_t end) -> std::uint64_t
+    {
+      return static_cast<std::uint64_t>(begin) << 32 | end;
+    }
+
+    std::mutex job_mutex_;
+    // Guards the job hand-off to the workers.
+    std::mutex mutex_;
+    std::condition_variable_any wake_;
+    std::uint64_t generation_{0};
+    bool open_{false};
+
+    chunk_fn fn_{nullptr};
+    void* fn_ctx_{nullptr};
+    std::size_t count_{0};
+    std::size_t grain_{1};
+    std::atomic<std::size_t> pending_{0};
+    std::atomic<std::size_t> active_{0};
+    std::vector<lane> lanes_;
+
+    // Declared last so the workers are joined before the state they use is destroyed.
+    std::vector<std::jthread> workers_;
+
+    auto pop_front(lane& own) -> std::optional<std::uint32_t>
+    {
+      auto range = own.range.load(std::memory_order_acquire);
+      while (true) {
+        const auto begin = static_cast<std::uint32_t>(range >> 32);
+        const auto end = static_cast<std::uint32_t>(range);
+        if (begin >= end) {
+          return std::nullopt;
+        }
+        if (own.range.compare_exchange_weak(range, pack(begin + 1, end), std::memory_order_acq_rel)) {
+          return begin;
+        }
+      }
+    }
+
+    auto steal_back(lane& victim) -> std::optional<std::uint32_t>
+    {
+      auto range = victim.range.load(std::memory_order_acquire);
+      while (true) {
+        const auto begin = static_cast<std::uint32_t>(range >> 32);
+        const auto end = static_cast<std::uint32_t>(range);
+        if (begin >= end) {
+          return std::nullopt;
+        }
+        if (victim.range.compare_exchange_weak(range, pack(begin, end - 1), std::memory_order_acq_rel)) {
+          return end - 1;
+        }
+      }
+    }
+
+    void run_chunk(const std::uint32_t chunk)
+    {
+      const auto begin = static_cast<std::size_t>(chunk) * grain_;
+      fn_(fn_ctx_, begin, (std::min)(begin + grain_, count_));
+      pending_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void work(const std::size_t self)
+    {
+      while (true) {
+        if (const auto chunk = pop_front(lanes_[self])) {
+          run_chunk(*chunk);
+          continue;
+        }
+
+        std::optional<std::uint32_t> stolen;
+        for (std::size_t offset = 1; offset < lanes_.size() && !stolen; ++offset) {
+          stolen = steal_back(lanes_[(self + offset) % lanes_.size()]);
+        }
+        if (!stolen) {
+          return;
+        }
+        run_chunk(*stolen);
+      }
+    }
+
+    void worker_loop(const std::stop_token& stop, const std::size_t self)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      std::uint64_t seen = 0;
+      while (wake_.wait(lock, stop, [&] { return open_ && generation_ != seen; })) {
+        seen = generation_;
+        active_.fetch_add(1, std::memory_order_acq_rel);
+        lock.unlock();
+        work(self);
+        active_.fetch_sub(1, std::memory_order_acq_rel);
+        lock.lock();
+      }
+    }
+
+    void run(const std::size_t count, const std::size_t grain, const chunk_fn fn, void* fn_ctx)
+    {
+      std::lock_guard<std::mutex> job_lock(job_mutex_);
+      const auto chunks = (count + grain - 1) / grain;
+      const auto participants = lanes_.size();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = fn;
+        fn_ctx_ = fn_ctx;
+        count_ = count;
+        grain_ = grain;
+        pending_.store(chunks, std::memory_order_release);
+        for (std::size_t i = 0; i < participants; ++i) {
+          lanes_[i].range.store(pack(static_cast<std::uint32_t>(chunks * i / participants),
+                                     static_cast<std::uint32_t>(chunks * (i + 1) / participants)),
+                                std::memory_order_release);
+        }
+        open_ = true;
+        ++generation_;
+      }
+      wake_.notify_all();
+
+      // The caller takes the last lane.
+      work(participants - 1);
+      while (pending_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+      }
+
+      // Late wakers no longer join, the ones already in finish their scan before the job state is reused.
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = false;
+      }
+      while (active_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+      }
+    }
+
+    // One worker per spare core, at most kMaxWorkers: the game keeps its own threads busy.
+    static auto default_worker_count() -> std::size_t
+    {
+      const auto hardware = std::thread::hardware_concurrency();
+      return (std::min)(hardware > 1 ? static_cast<std::size_t>(hardware) - 1 : 0, kMaxWorkers);
+    }
+
+  public:
+    // The plugin uses the singleton; a pool of its own is for host benchmarks that compare worker counts.
+    explicit thread_pool(const std::size_t workers)
+    {
+      lanes_ = std::vector<lane>(workers + 1);
+      workers_.reserve(workers);
+      for (std::size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this, i](const std::stop_token& stop) { worker_loop(stop, i); });
+      }
+    }
+
+    static auto get_singleton() -> thread_pool*
+    {
+      static thread_pool singleton(default_worker_count());
+      return std::addressof(singleton);
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+    [[nodiscard]] auto get_worker_count() const -> std::size_t
+    {
+      return workers_.size();
+    }
+
+    // Calls fn(begin, end) for consecutive ranges of at most grain items covering [0, count). Ranges run
+    // concurrently and in no particular order; fn must not start another parallel_for. A job of one chunk
+    // runs on the caller without waking anyone.
+    template <typename Fn>
+    void parallel_for(const std::size_t count, const std::size_t grain, Fn&& fn)
+    {
+      if (count == 0) {
+        return;
+      }
+      const auto step = (std::max)(grain, std::size_t{1});
+      if (count <= step || workers_.empty()) {
+        fn(std::size_t{0}, count);
+        return;
+      }
+
+      run(count, step,
+          [](void* ctx, const std::size_t begin, const std::size_t end) {
+            (*static_cast<std::remove_reference_t<Fn>*>(ctx))(begin, end);
+          },
+          const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+    }
+  };
+}
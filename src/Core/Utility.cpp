@@ -1,10 +1,18 @@
 ﻿module;
 
 #include <expected>
+#include <memory_resource>
+#include <span>
+#include <unordered_map>
 #include <Windows.h>
 
 export module TrueFlasks.Core.Utility;
 
+import TrueFlasks.Core.MenuTracker;
+import TrueFlasks.Core.FrameArena;
+import TrueFlasks.Core.ItemCounts;
+import TrueFlasks.Core.Telemetry;
+
 namespace core::utility::strings
 {
   export auto trim(const std::string& str) -> std::string
@@ -356,6 +364,7 @@ namespace core::utility
     explicit visitor_magic_target_sum_by_keyword(RE::BGSKeyword* keyword_filter) : keyword(keyword_filter) {}
     
     float sum = 0.f;
+    std::uint32_t visited = 0;
     
   private:
     RE::BGSKeyword* keyword;
@@ -373,7 +382,7 @@ namespace core::utility
     
     RE::BSContainer::ForEachResult Accept(RE::ActiveEffect* active_effect) override
     {
-      
+      ++visited;
       if (filter(active_effect)) {
         const auto is_detrimental = active_effect->effect->baseEffect->data.flags.any(RE::EffectSetting::EffectSettingData::Flag::kDetrimental);
         
@@ -397,15 +406,78 @@ namespace core::utility
     
     auto visitor = visitor_magic_target_sum_by_keyword(keyword);
     actor->AsMagicTarget()->VisitEffects(visitor);
+    core::telemetry::telemetry::get_singleton()->add(core::telemetry::metric::effect_visits, visitor.visited);
     
     return visitor.sum;
   }
 
+  // Same filter and sign rules as visitor_magic_target_sum_by_keyword, but sums several keyword masks in one walk
+  // over the effect list. mask_of(base_effect) is taken once per effect, sums[i] receives the total of the effects
+  // sharing a bit with masks[i], so empty masks stay at zero.
+  export template <typename Mask, typename MaskOf>
+  struct visitor_magic_target_sum_by_masks : RE::MagicTarget::ForEachActiveEffectVisitor
+  {
+    visitor_magic_target_sum_by_masks(const std::span<const Mask> masks_filter, const std::span<float> sums_out,
+                                      MaskOf mask_of_fn) :
+      masks(masks_filter), sums(sums_out), mask_of(std::move(mask_of_fn))
+    {
+      std::ranges::fill(sums, 0.f);
+    }
+
+    std::uint32_t visited = 0;
+
+  private:
+    std::span<const Mask> masks;
+    std::span<float> sums;
+    MaskOf mask_of;
+
+    RE::BSContainer::ForEachResult Accept(RE::ActiveEffect* active_effect) override
+    {
+      ++visited;
+      if (!active_effect || active_effect->flags.any(RE::ActiveEffect::Flag::kInactive) || !active_effect->effect) {
+        return RE::BSContainer::ForEachResult::kContinue;
+      }
+
+      const auto base_effect = active_effect->effect->baseEffect;
+      if (!base_effect || !base_effect->data.flags.any(RE::EffectSetting::EffectSettingData::Flag::kRecover)) {
+        return RE::BSContainer::ForEachResult::kContinue;
+      }
+
+      const auto is_detrimental = base_effect->data.flags.any(RE::EffectSetting::EffectSettingData::Flag::kDetrimental);
+      const auto magnitude = is_detrimental ? -active_effect->magnitude : active_effect->magnitude;
+      const Mask effect_mask = mask_of(base_effect);
+      for (std::size_t i = 0; i < masks.size() && i < sums.size(); ++i) {
+        if ((effect_mask & masks[i]).any()) {
+          sums[i] += magnitude;
+        }
+      }
+
+      return RE::BSContainer::ForEachResult::kContinue;
+    }
+  };
+
+  export template <typename Mask, typename MaskOf>
+  auto get_sums_of_active_effects_magnitude_with_masks(RE::Actor* actor, const std::span<const Mask> masks,
+                                                       const std::span<float> sums, MaskOf&& mask_of) -> void
+  {
+    auto visitor =
+      visitor_magic_target_sum_by_masks<Mask, std::decay_t<MaskOf>>(masks, sums, std::forward<MaskOf>(mask_of));
+    if (!actor || !actor->AsMagicTarget()) {
+      return;
+    }
+
+    actor->AsMagicTarget()->VisitEffects(visitor);
+    core::telemetry::telemetry::get_singleton()->add(core::telemetry::metric::effect_visits, visitor.visited);
+  }
+
+  // Pass the frame arena as resource when the result is dropped before the frame ends.
   export auto get_active_effects_by_keyword(RE::Actor* actor,
                                             const RE::BGSKeyword* keyword,
-                                            const bool is_only_active = true) -> std::vector<RE::ActiveEffect*>
+                                            const bool is_only_active = true,
+                                            std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    -> std::pmr::vector<RE::ActiveEffect*>
   {
-    auto result = std::vector<RE::ActiveEffect*>();
+    auto result = std::pmr::vector<RE::ActiveEffect*>(resource);
 
     if (!actor || !keyword) {
       return result;
@@ -509,25 +581,15 @@ namespace core::utility
     return false;
   }
 
+  // Main thread only. The menu list is configurable, see HotkeyBlockingMenus.
   export auto is_any_menu_open() -> bool
   {
     const auto ui = RE::UI::GetSingleton();
     const auto player = RE::PlayerCharacter::GetSingleton();
     if (player && ui &&
-        (ui->GameIsPaused() || ui->IsMenuOpen(RE::TweenMenu::MENU_NAME) || ui->IsMenuOpen(RE::DialogueMenu::MENU_NAME)
-         ||
-         ui->IsMenuOpen(RE::MagicMenu::MENU_NAME) || ui->IsMenuOpen(RE::InventoryMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::LockpickingMenu::MENU_NAME) || ui->IsMenuOpen(RE::RaceSexMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::StatsMenu::MENU_NAME) || ui->IsMenuOpen(RE::LoadingMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::Console::MENU_NAME) || ui->IsMenuOpen(RE::FaderMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::FavoritesMenu::MENU_NAME) || ui->IsMenuOpen(RE::SleepWaitMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::JournalMenu::MENU_NAME) || ui->IsMenuOpen(RE::BarterMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::MainMenu::MENU_NAME) || ui->IsMenuOpen(RE::BookMenu::MENU_NAME) ||
-         ui->IsMenuOpen(RE::ContainerMenu::MENU_NAME) || ui->IsMenuOpen(RE::GiftMenu::MENU_NAME) || ui->
-         IsMenuOpen(RE::MessageBoxMenu::MENU_NAME) || ui->IsMenuOpen(RE::TrainingMenu::MENU_NAME) || ui->
-         IsMenuOpen(RE::MapMenu::MENU_NAME) || ui->IsMenuOpen(RE::TutorialMenu::MENU_NAME) || ui->
-         IsMenuOpen(RE::LevelUpMenu::MENU_NAME) || ui->IsMenuOpen(RE::CreditsMenu::MENU_NAME) || ui->
-         IsMenuOpen("LootMenuIE") || ui->IsMenuOpen("LootMenu") || CheckIfWheelerOpen())) {
+        (ui->GameIsPaused() ||
+         core::menu_tracker::menu_tracker::get_singleton()->is_any_open(core::menu_tracker::menu_group::block_hotkeys) ||
+         CheckIfWheelerOpen())) {
       return true;
     }
     return false;
@@ -607,72 +669,71 @@ namespace core::utility::game
     return func(NULL, NULL, target, object, count, persistent, disabled);
   }
   
-  export auto get_item_count(RE::TESObjectREFR* a_container, RE::FormID a_formID) -> std::int32_t
+  // Totals per object of a container: base container counts plus the inventory changes, one walk over each.
+  // Leveled entries carry their full count in countDelta. Only objects accepted by filter are collected.
+  // The totals are scratch for the caller and live in the frame arena.
+  template <typename Filter>
+  auto get_item_totals(RE::TESObjectREFR* a_container, Filter&& filter)
+    -> core::item_counts::item_totals<RE::TESBoundObject*>
   {
-    std::int32_t iResult = 0;
-
-    auto invChanges = a_container->GetInventoryChanges();
-    if (invChanges && invChanges->entryList) {
-      for (auto& entry : *invChanges->entryList) {
-        if (entry && entry->object && entry->object->formID == a_formID) {
-          if (entry->IsLeveled()) {
-            return entry->countDelta > 0 ? entry->countDelta : 0;
-          } else {
-            iResult = entry->countDelta;
-            break;
-          }
-        }
-      }
+    core::item_counts::item_totals<RE::TESBoundObject*> totals(
+      core::frame_arena::frame_arena::get_singleton()->resource());
+    if (!a_container) {
+      return totals;
     }
+    core::telemetry::telemetry::get_singleton()->add(core::telemetry::metric::inventory_scans);
 
-    auto container = a_container->GetContainer();
-    if (container) {
+    if (auto container = a_container->GetContainer()) {
       container->ForEachContainerObject([&](RE::ContainerObject& a_entry) {
-        if (a_entry.obj && a_entry.obj->formID == a_formID) {
-          iResult += a_entry.count;
-          return RE::BSContainer::ForEachResult::kStop;
+        if (a_entry.obj && filter(a_entry.obj)) {
+          totals.add_base(a_entry.obj, a_entry.count);
         }
         return RE::BSContainer::ForEachResult::kContinue;
       });
     }
 
-    return iResult > 0 ? iResult : 0;
-  }
-  
-  export auto get_item_count_with_keyword(RE::TESObjectREFR* a_container, const RE::FormType form_type, const RE::BGSKeyword* keyword) -> std::int32_t
-  {
-    std::int32_t iResult = 0;
-    
-    if (!a_container || !keyword) {
-      return iResult;
-    }
-
     auto invChanges = a_container->GetInventoryChanges();
     if (invChanges && invChanges->entryList) {
       for (auto& entry : *invChanges->entryList) {
-        if (entry && entry->object && entry->object->GetFormType() == form_type && try_form_has_keyword(entry->object, keyword)) {
-          if (entry->IsLeveled()) {
-            return entry->countDelta > 0 ? entry->countDelta : 0;
-          } else {
-            iResult = entry->countDelta;
-            break;
-          }
+        if (entry && entry->object && filter(entry->object)) {
+          totals.add_change(entry->object, entry->countDelta, entry->IsLeveled());
         }
       }
     }
 
-    auto container = a_container->GetContainer();
-    if (container) {
-      container->ForEachContainerObject([&](RE::ContainerObject& a_entry) {
-        if (a_entry.obj && a_entry.obj->GetFormType() == form_type && try_form_has_keyword(a_entry.obj, keyword)) {
-          iResult += a_entry.count;
-          return RE::BSContainer::ForEachResult::kStop;
-        }
-        return RE::BSContainer::ForEachResult::kContinue;
-      });
-    }
+    return totals;
+  }
+
+  export auto get_item_count(RE::TESObjectREFR* a_container, RE::FormID a_formID) -> std::int32_t
+  {
+    return get_item_totals(a_container, [a_formID](const RE::TESBoundObject* object) {
+             return object->formID == a_formID;
+           }).count();
+  }
+
+  // Counts items of form_type for several keys with one walk over the container: counts[i] receives the total of
+  // every item for which matches(item, i) holds, an item matching several keys counts towards each.
+  export template <typename Matches>
+  auto get_item_counts(RE::TESObjectREFR* a_container, const RE::FormType form_type,
+                       const std::span<std::int32_t> counts, Matches&& matches) -> void
+  {
+    const auto totals = get_item_totals(a_container, [form_type](const RE::TESBoundObject* object) {
+      return object->GetFormType() == form_type;
+    });
+    core::item_counts::count_per_key(totals, counts, std::forward<Matches>(matches));
+  }
 
-    return iResult > 0 ? iResult : 0;
+  export auto get_item_count_with_keyword(RE::TESObjectREFR* a_container, const RE::FormType form_type, const RE::BGSKeyword* keyword) -> std::int32_t
+  {
+    std::int32_t iResult = 0;
+    if (!keyword) {
+      return iResult;
+    }
+    get_item_counts(a_container, form_type, std::span{&iResult, 1},
+                    [keyword](const RE::TESBoundObject* object, std::size_t) {
+                      return try_form_has_keyword(object, keyword);
+                    });
+    return iResult;
   }
   
   export auto get_object_in_inventory_by_keyword(RE::Actor* actor, const RE::BGSKeyword* keyword, const RE::FormType formType) -> RE::TESBoundObject*
@@ -681,6 +742,7 @@ namespace core::utility::game
       return nullptr;
     }
 
+    core::telemetry::telemetry::get_singleton()->add(core::telemetry::metric::inventory_scans);
     const auto inv = actor->GetInventory([formType](RE::TESBoundObject& object) {
         return object.GetFormType() == formType;
     });
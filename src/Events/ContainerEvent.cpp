@@ -0,0 +1,43 @@
+export module TrueFlasks.Events.ContainerEvent;
+
+import TrueFlasks.Events.EventsCtx;
+import TrueFlasks.Features.TrueFlasks;
+import TrueFlasks.Core.AllocationProfiler;
+import TrueFlasks.Core.Telemetry;
+
+namespace events::container_event {
+
+  export struct container_event_handler final : RE::BSTEventSink<RE::TESContainerChangedEvent>
+  {
+    static auto get_singleton() -> container_event_handler*
+    {
+      static container_event_handler singleton;
+      return std::addressof(singleton);
+    }
+
+    static auto register_handler() -> void
+    {
+      logger::info("Start register container changed handler"sv);
+      if (const auto event_source = RE::ScriptEventSourceHolder::GetSingleton()) {
+        event_source->AddEventSink<RE::TESContainerChangedEvent>(get_singleton());
+        logger::info("Finish register container changed handler"sv);
+      }
+    }
+
+    auto ProcessEvent(const RE::TESContainerChangedEvent* container_event,
+                      RE::BSTEventSource<RE::TESContainerChangedEvent>* event_source)
+      -> RE::BSEventNotifyControl override
+    {
+      if (!container_event) {
+        return RE::BSEventNotifyControl::kContinue;
+      }
+
+      core::telemetry::hook_timer timer(core::telemetry::hook::container_event);
+      core::allocation_profiler::site_scope site(core::allocation_profiler::alloc_site::container_event);
+      auto ctx = events_ctx::process_event_container_changed_ctx{container_event, event_source};
+      features::true_flasks::on_container_changed(ctx);
+      return RE::BSEventNotifyControl::kContinue;
+    }
+  };
+
+}
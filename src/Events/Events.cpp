@@ -1,5 +1,6 @@
 ﻿export module TrueFlasks.Events;
 
+import TrueFlasks.Events.ContainerEvent;
 import TrueFlasks.Events.InputEvent;
 import TrueFlasks.Events.MenuEvent;
 
@@ -9,5 +10,6 @@ namespace events
   {
     input_event::input_event_handler::register_handler();
     menu_event::menu_event_handler::register_handler();
+    container_event::container_event_handler::register_handler();
   }
 }
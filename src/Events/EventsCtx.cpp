@@ -18,5 +18,11 @@ export namespace events::events_ctx
     RE::INPUT_DEVICE device;
     uint32_t key;
   };
+
+  struct process_event_container_changed_ctx final
+  {
+    const RE::TESContainerChangedEvent* container_event;
+    RE::BSTEventSource<RE::TESContainerChangedEvent>* event_source;
+  };
   
 }
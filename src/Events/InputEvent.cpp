@@ -2,6 +2,8 @@ export module TrueFlasks.Events.InputEvent;
 
 import TrueFlasks.Events.EventsCtx;
 import TrueFlasks.Features.TrueFlasks;
+import TrueFlasks.Core.AllocationProfiler;
+import TrueFlasks.Core.Telemetry;
 
 namespace events::input_event {
 
@@ -29,6 +31,8 @@ namespace events::input_event {
                       RE::BSTEventSource<RE::InputEvent*>* event_source)
       -> RE::BSEventNotifyControl override
     {
+      core::telemetry::hook_timer timer(core::telemetry::hook::input_event);
+      core::allocation_profiler::site_scope site(core::allocation_profiler::alloc_site::input);
       for (auto input_event = *event; input_event; input_event = input_event->next) {
         if (const auto button = input_event->AsButtonEvent(); button) {
           const auto device = input_event->GetDevice();
@@ -1,7 +1,9 @@
 export module TrueFlasks.Events.MenuEvent;
 
 import TrueFlasks.Events.EventsCtx;
+import TrueFlasks.Core.MenuTracker;
 import TrueFlasks.UI.Prisma;
+import TrueFlasks.Core.Telemetry;
 
 namespace events::menu_event {
 
@@ -32,7 +34,13 @@ export struct menu_event_handler final : RE::BSTEventSink<RE::MenuOpenCloseEvent
     }
 
     auto ctx = events_ctx::process_event_menu_ctx{menu_event, event_source, menu_event->menuName, menu_event->opening};
+    // Before anything reads the open menus, so they already see this change.
+    core::menu_tracker::menu_tracker::get_singleton()->on_menu_event(ctx.menu_name, ctx.is_opening);
     ui::prisma::on_menu_event(ctx);
+    // Quit leaves the game through the main menu.
+    if (ctx.is_opening && ctx.menu_name == RE::MainMenu::MENU_NAME) {
+      core::telemetry::telemetry::get_singleton()->export_now("quit");
+    }
     return RE::BSEventNotifyControl::kContinue;
   }
     
@@ -2,6 +2,8 @@ module;
 
 #include "API/TrueFlasksAPI.h"
 #include "RE/E/EffectSetting.h"
+#include <bit>
+#include <memory_resource>
 
 export module TrueFlasks.Features.TrueFlasks;
 
@@ -17,6 +19,11 @@ import TrueFlasks.Core.HooksCtx;
 import TrueFlasks.Config;
 import TrueFlasks.Core.ActorsCache;
 import TrueFlasks.Core.Utility;
+import TrueFlasks.Core.ThreadPool;
+import TrueFlasks.Core.KeywordIndex;
+import TrueFlasks.Core.DepositPlan;
+import TrueFlasks.Core.FrameArena;
+import TrueFlasks.Core.Telemetry;
 import TrueFlasks.API.ModAPI;
 import TrueFlasks.Events.EventsCtx;
 
@@ -29,8 +36,16 @@ namespace features::true_flasks
 
   constexpr int kFlaskTypeCount = core::actors_cache::cache_data::actor_data::FLASK_TYPE_SIZE;
   constexpr int kFlaskMaxCount = core::actors_cache::cache_data::actor_data::FLASK_ARRAY_SIZE;
+  constexpr int kFlaskCategoryMaxCount = core::actors_cache::cache_data::actor_data::FLASK_CATEGORY_MAX_SIZE;
+  static_assert(kFlaskCategoryMaxCount == config::kMaxFlaskCategories);
   constexpr auto kFlaskTypes = std::array{flask_type::Health, flask_type::Stamina, flask_type::Magick, flask_type::Other};
   using effect_flag = RE::EffectSetting::EffectSettingData::Flag;
+  static_assert(static_cast<int>(core::deposit_plan::select_order::weakest_first) ==
+                  static_cast<int>(inventory_select_mode::weakest_first) &&
+                static_cast<int>(core::deposit_plan::select_order::strongest_first) ==
+                  static_cast<int>(inventory_select_mode::strongest_first) &&
+                static_cast<int>(core::deposit_plan::select_order::first_found) ==
+                  static_cast<int>(inventory_select_mode::first_found));
   using effect_archetype = RE::EffectSetting::Archetype;
 
   struct pending_inventory_drink
@@ -42,10 +57,21 @@ namespace features::true_flasks
 
   thread_local pending_inventory_drink g_pending_inventory_drink{};
 
-  bool is_valid_flask_type(const flask_type type)
+  // Built-in types plus the categories of the given settings.
+  int get_flask_type_count(const config::config_values* config)
+  {
+    return kFlaskTypeCount + static_cast<int>(config->categories.size());
+  }
+
+  bool is_valid_flask_type(const config::settings_snapshot* snapshot, const flask_type type)
   {
     const auto type_index = static_cast<int>(type);
-    return type_index >= 0 && type_index < kFlaskTypeCount;
+    return type_index >= 0 && type_index < get_flask_type_count(&snapshot->values);
+  }
+
+  export bool is_valid_flask_type(const flask_type type)
+  {
+    return is_valid_flask_type(config::current_snapshot().get(), type);
   }
 
   int get_slot_limit(const int max_slots)
@@ -53,13 +79,22 @@ namespace features::true_flasks
     return (std::min)((std::max)(max_slots, 0), kFlaskMaxCount);
   }
 
-  bool is_valid_inventory_use_potion(RE::AlchemyItem* potion, const config::flask_settings_base& settings,
-                                     const flask_type type);
-  bool is_valid_inventory_deposit_potion(RE::AlchemyItem* potion, const config::flask_settings_base& settings);
-  RE::AlchemyItem* get_selected_inventory_potion(RE::Actor* actor, const config::flask_settings_base& settings,
-                                                 const flask_type type, const bool for_deposit);
+  bool is_valid_inventory_use_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                                     const config::flask_settings_base& settings, const flask_type type);
+  bool is_valid_inventory_deposit_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                                         const config::flask_settings_base& settings, const flask_type type);
+  RE::AlchemyItem* get_selected_inventory_potion(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                                                 const config::flask_settings_base& settings, const flask_type type,
+                                                 const bool for_deposit);
   bool consume_pending_inventory_drink(RE::Actor* actor, const RE::AlchemyItem* potion);
 
+  enum class inventory_purpose : std::uint8_t
+  {
+    use = 0,
+    deposit = 1
+  };
+
+
   int get_actual_item_count(RE::Actor* actor, RE::AlchemyItem* potion, const int fallback_count)
   {
     if (!actor || !potion) {
@@ -75,7 +110,7 @@ namespace features::true_flasks
     return fallback_count;
   }
 
-  const config::flask_settings_base* get_settings(const config::config_manager* config, const flask_type type)
+  const config::flask_settings_base* get_settings(const config::config_values* config, const flask_type type)
   {
     switch (type) {
     case flask_type::Health: return &config->flasks_health;
@@ -83,21 +118,44 @@ namespace features::true_flasks
     case flask_type::Magick: return &config->flasks_magick;
     case flask_type::Other: return &config->flasks_other;
     }
-    return nullptr;
+    const auto category = static_cast<std::size_t>(type) - static_cast<std::size_t>(kFlaskTypeCount);
+    return category < config->categories.size() ? &config->categories[category] : nullptr;
+  }
+
+  // The potion's keyword masks under the snapshot's bits, cached per form.
+  core::keyword_index::potion_masks get_potion_masks(const RE::AlchemyItem* potion,
+                                                     const config::settings_snapshot* snapshot)
+  {
+    return core::keyword_index::keyword_index::get_singleton()->potion_masks_of(potion, snapshot->keyword_bits,
+                                                                                snapshot->version);
+  }
+
+  core::keyword_index::keyword_mask get_effect_mask(const RE::EffectSetting* effect,
+                                                    const config::settings_snapshot* snapshot)
+  {
+    return core::keyword_index::keyword_index::get_singleton()->effect_mask_of(effect, snapshot->keyword_bits,
+                                                                               snapshot->version);
   }
 
-  std::optional<flask_type> identify_flask_type(const RE::AlchemyItem* potion, const config::config_manager* config)
+  // Keyword masks of a type of the snapshot. The type has to be valid in it.
+  const config::type_keyword_masks& get_type_masks(const config::settings_snapshot* snapshot, const flask_type type)
   {
-    if (config->flasks_health.keyword && core::utility::try_form_has_keyword(potion, config->flasks_health.keyword))
-      return flask_type::Health;
-    if (config->flasks_stamina.keyword && core::utility::try_form_has_keyword(potion, config->flasks_stamina.keyword))
-      return flask_type::Stamina;
-    if (config->flasks_magick.keyword && core::utility::try_form_has_keyword(potion, config->flasks_magick.keyword))
-      return flask_type::Magick;
+    return snapshot->type_masks[static_cast<std::size_t>(type)];
+  }
+
+  std::optional<flask_type> identify_flask_type(const RE::AlchemyItem* potion, const config::settings_snapshot* snapshot)
+  {
+    const auto config = &snapshot->values;
+    // Health, Stamina, Magick, then the categories; Other has no flask keyword and never matches here.
+    const auto own = get_potion_masks(potion, snapshot).own;
+    for (std::size_t i = 0; i < snapshot->type_masks.size(); ++i) {
+      if ((own & snapshot->type_masks[i].flask).any())
+        return static_cast<flask_type>(i);
+    }
 
     bool is_other = true;
-    if (config->flasks_other.exclusive_keyword) {
-      const bool has_kw = core::utility::try_form_has_keyword(potion, config->flasks_other.exclusive_keyword);
+    if (snapshot->other_exclusive.any()) {
+      const bool has_kw = (own & snapshot->other_exclusive).any();
       if (config->flasks_other.revert_exclusive) {
         is_other = has_kw;
       }
@@ -117,181 +175,263 @@ namespace features::true_flasks
 
     return std::nullopt;
   }
+
+  // Classification only depends on the potion's keywords and the settings, so results are kept per form until a
+  // new settings snapshot is published. Player-made potions are dynamic forms whose IDs get reused, they are
+  // always classified directly.
+  struct classification_cache
+  {
+    std::shared_mutex mutex;
+    std::uint64_t version{0};
+    // -1 marks a potion that is not a flask.
+    std::unordered_map<RE::FormID, std::int8_t> types;
+  };
+
+  // Classifies against the caller's snapshot, so the type always agrees with the settings the caller reads next.
+  std::optional<flask_type> classify_potion(const RE::AlchemyItem* potion, const config::settings_snapshot* snapshot)
+  {
+    if (!potion || potion->IsDynamicForm()) {
+      return identify_flask_type(potion, snapshot);
+    }
+
+    static classification_cache cache;
+    {
+      std::shared_lock lock(cache.mutex);
+      if (cache.version == snapshot->version) {
+        if (const auto it = cache.types.find(potion->GetFormID()); it != cache.types.end()) {
+          return it->second < 0 ? std::nullopt : std::optional{static_cast<flask_type>(it->second)};
+        }
+      }
+    }
+
+    const auto type = identify_flask_type(potion, snapshot);
+
+    std::unique_lock lock(cache.mutex);
+    if (cache.version > snapshot->version) {
+      return type;
+    }
+    if (cache.version < snapshot->version) {
+      cache.types.clear();
+      cache.version = snapshot->version;
+    }
+    cache.types.emplace(potion->GetFormID(), type ? static_cast<std::int8_t>(*type) : std::int8_t{-1});
+    return type;
+  }
   
-  bool is_in_inventory_mode(const RE::Actor* actor, const flask_type type)
+  bool is_in_inventory_mode(const RE::Actor* actor, const config::settings_snapshot* snapshot, const flask_type type)
   {
-    auto settings = get_settings(config::config_manager::get_singleton(), type);
+    auto settings = get_settings(&snapshot->values, type);
     if (actor && core::utility::is_player(actor) && settings->inventory_keyword && settings->inventory_mode_value != inventory_mode::disabled) {
       return true;
     }
     return false;
   }
   
-  bool is_in_inventory_mode_deposit(const RE::Actor* actor, const flask_type type)
+  bool is_in_inventory_mode_deposit(const RE::Actor* actor, const config::settings_snapshot* snapshot, const flask_type type)
   {
-    auto settings = get_settings(config::config_manager::get_singleton(), type);
+    auto settings = get_settings(&snapshot->values, type);
     if (actor && core::utility::is_player(actor) && settings->inventory_keyword && settings->inventory_mode_value == inventory_mode::deposit) {
       return true;
     }
     return false;
   }
   
-  bool is_in_inventory_mod_use(const RE::Actor* actor, const flask_type type)
+  bool is_in_inventory_mod_use(const RE::Actor* actor, const config::settings_snapshot* snapshot, const flask_type type)
   {
-    if (type == flask_type::Other) {
+    // Use mode needs the restored actor value, Other and the categories have none and support deposit only.
+    if (type >= flask_type::Other) {
       return false;
     }
-    auto settings = get_settings(config::config_manager::get_singleton(), type);
+    auto settings = get_settings(&snapshot->values, type);
     if (actor && core::utility::is_player(actor) && settings->inventory_keyword && settings->inventory_mode_value == inventory_mode::use) {
       return true;
     }
     return false;
   }
   
-  export auto try_potion_has_keyword(const RE::AlchemyItem* potion, const RE::BGSKeyword* keyword) -> bool
+  // Keyword of the mask on the potion itself or on one of its effects.
+  auto try_potion_has_keyword(const RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                              const core::keyword_index::keyword_mask& keyword) -> bool
   {
-    if (!potion || !keyword) {
-      return false;
-    }
-    
-    if (potion->HasKeyword(keyword)) {
-      return true;
-    }
-
-    for (const auto effect : potion->effects) {
-        if (effect && effect->baseEffect && effect->baseEffect->HasKeyword(keyword)) {
-          return true;
-        }
-    }
-
-    return false;
+    return (get_potion_masks(potion, snapshot).with_effects & keyword).any();
   }
   
-  export auto get_potion_count_with_keyword(RE::TESObjectREFR* a_container, const RE::BGSKeyword* keyword) -> std::int32_t
+  // Use-mode potion totals of every type, counted with one walk over the player's inventory and kept until the
+  // inventory or the settings change.
+  struct potion_count_cache final
   {
-    std::int32_t iResult = 0;
-    
-    if (!a_container || !keyword) {
-      return iResult;
-    }
-
-    auto invChanges = a_container->GetInventoryChanges();
-    if (invChanges && invChanges->entryList) {
-      for (auto& entry : *invChanges->entryList) {
-        if (entry && entry->object && entry->object->GetFormType() == RE::FormType::AlchemyItem && try_potion_has_keyword(entry->object->As<RE::AlchemyItem>(), keyword)) {
-          if (entry->IsLeveled()) {
-            return entry->countDelta > 0 ? entry->countDelta : 0;
-          } else {
-            iResult = entry->countDelta;
-            break;
-          }
-        }
-      }
-    }
+    std::mutex mutex;
+    std::uint64_t version{0};
+    std::array<std::int32_t, kFlaskTypeCount + kFlaskCategoryMaxCount> counts{};
+  };
 
-    auto container = a_container->GetContainer();
-    if (container) {
-      container->ForEachContainerObject([&](RE::ContainerObject& a_entry) {
-        if (a_entry.obj && a_entry.obj->GetFormType() == RE::FormType::AlchemyItem && try_potion_has_keyword(a_entry.obj->As<RE::AlchemyItem>(), keyword)) {
-          iResult += a_entry.count;
-          return RE::BSContainer::ForEachResult::kStop;
-        }
-        return RE::BSContainer::ForEachResult::kContinue;
-      });
-    }
+  std::atomic<bool> g_potion_counts_dirty{true};
 
-    return iResult > 0 ? iResult : 0;
-  }
-  
-  int get_potions_count(RE::Actor* actor, const config::flask_settings_base& settings, const flask_type type)
+  int get_potions_count(RE::Actor* actor, const config::settings_snapshot* snapshot, const flask_type type)
   {
-    if (!is_in_inventory_mode(actor, type)) {
+    if (!is_in_inventory_mode(actor, snapshot, type)) {
       return 0;
     }
 
-    int count = 0;
-    const auto inventory = actor->GetInventory([](RE::TESBoundObject& object) {
-      return object.GetFormType() == RE::FormType::AlchemyItem;
-    });
+    static potion_count_cache cache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (g_potion_counts_dirty.exchange(false, std::memory_order_acq_rel) || cache.version != snapshot->version) {
+      cache.version = snapshot->version;
+      const auto type_count = static_cast<std::size_t>(get_flask_type_count(&snapshot->values));
+      core::utility::game::get_item_counts(
+        actor, RE::FormType::AlchemyItem, std::span{cache.counts}.first(type_count),
+        [snapshot](RE::TESBoundObject* object, const std::size_t index) {
+          const auto count_type = static_cast<flask_type>(index);
+          return is_valid_inventory_use_potion(object->As<RE::AlchemyItem>(), snapshot,
+                                               *get_settings(&snapshot->values, count_type), count_type);
+        });
+    }
+    return cache.counts[static_cast<std::size_t>(type)];
+  }
 
-    for (const auto& [item, inv_data] : inventory) {
-      const auto& [item_count, entry] = inv_data;
-      if (item_count <= 0 || !entry) {
-        continue;
-      }
+  // Frame number, advanced once per frame by the player update and by every inventory change. Evaluations stamped
+  // with an older one are redone.
+  std::atomic<std::uint64_t> g_frame{1};
 
-      auto* potion = item ? item->As<RE::AlchemyItem>() : nullptr;
-      const auto actual_count = get_actual_item_count(actor, potion, item_count);
-      if (actual_count <= 0) {
-        continue;
-      }
+  // Menus stop the player update and with it the frame number, while the player can still equip gear or drink a
+  // potion. Evaluations older than this are redone regardless of the frame.
+  constexpr std::uint64_t kEvaluationMaxAgeMs = 100;
 
-      if (is_valid_inventory_use_potion(potion, settings, type)) {
-        count += actual_count;
-      }
+  export void begin_frame()
+  {
+    g_frame.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  enum class effect_input : std::uint8_t
+  {
+    cap = 0,
+    cooldown = 1,
+    regen = 2
+  };
+
+  // Keyword magnitude sums behind max slots, cooldown and regen multiplier of every flask type for one actor.
+  // Gathered with one walk over the actor's active effects and reused until the frame or the settings change,
+  // at most kEvaluationMaxAgeMs.
+  struct actor_evaluation final
+  {
+    static constexpr std::size_t kInputCount = 3;
+
+    RE::FormID form_id{0};
+    std::uint64_t frame{0};
+    // GetTickCount64() at evaluation.
+    std::uint64_t tick{0};
+    std::uint64_t settings_version{0};
+    std::array<std::array<float, kFlaskTypeCount + kFlaskCategoryMaxCount>, kInputCount> sums{};
+  };
+
+  struct evaluation_cache final
+  {
+    // Entry 0 is the player's, the rest are shared by NPCs by FormID.
+    static constexpr std::size_t kSize = 32;
+
+    std::mutex mutex;
+    std::array<actor_evaluation, kSize> entries;
+  };
+
+  evaluation_cache g_evaluations;
+
+  void evaluate_actor(RE::Actor* actor, const config::settings_snapshot* snapshot, const std::uint64_t now,
+                      actor_evaluation& out)
+  {
+    // Laid out input-major by the snapshot: every type's cap, then cooldown, then regeneration.
+    const auto type_count = snapshot->type_masks.size();
+    const std::span<const core::keyword_index::keyword_mask> masks{snapshot->effect_input_masks};
+    std::array<float, actor_evaluation::kInputCount * (kFlaskTypeCount + kFlaskCategoryMaxCount)> sums{};
+    if (!masks.empty()) {
+      core::utility::get_sums_of_active_effects_magnitude_with_masks(
+        actor, masks, std::span{sums}.first(masks.size()),
+        [snapshot](const RE::EffectSetting* effect) { return get_effect_mask(effect, snapshot); });
+    }
+
+    out.form_id = actor->GetFormID();
+    out.frame = g_frame.load(std::memory_order_relaxed);
+    out.tick = now;
+    out.settings_version = snapshot->version;
+    for (std::size_t input = 0; input < actor_evaluation::kInputCount; ++input) {
+      out.sums[input].fill(0.f);
+      std::copy_n(sums.begin() + static_cast<std::ptrdiff_t>(input * type_count), type_count,
+                  out.sums[input].begin());
     }
+  }
+
+  // Keyword magnitude sum of one input of one type, from the actor's evaluation of this frame.
+  float get_effect_input(RE::Actor* actor, const config::settings_snapshot* snapshot, const effect_input input,
+                         const flask_type type)
+  {
+    const auto type_index = static_cast<std::size_t>(type);
+    if (!actor || type_index >= kFlaskTypeCount + kFlaskCategoryMaxCount) {
+      return 0.f;
+    }
+
+    const auto form_id = actor->GetFormID();
+    const auto slot = core::utility::is_player(actor) ? 0 : 1 + form_id % (evaluation_cache::kSize - 1);
 
-    return count;
+    const auto now = GetTickCount64();
+    std::lock_guard<std::mutex> lock(g_evaluations.mutex);
+    auto& entry = g_evaluations.entries[slot];
+    if (entry.form_id != form_id || entry.frame != g_frame.load(std::memory_order_relaxed) ||
+        entry.settings_version != snapshot->version || now - entry.tick > kEvaluationMaxAgeMs) {
+      evaluate_actor(actor, snapshot, now, entry);
+    }
+    return entry.sums[static_cast<std::size_t>(input)][type_index];
   }
 
-  int calculate_max_slots(RE::Actor* actor, const config::flask_settings_base& settings, const flask_type type)
+  int calculate_max_slots(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                          const config::flask_settings_base& settings, const flask_type type)
   {
     
-    if (is_in_inventory_mod_use(actor, type)) {
-      return get_potions_count(actor, settings, type);
+    if (is_in_inventory_mod_use(actor, snapshot, type)) {
+      return get_potions_count(actor, snapshot, type);
     }
     
     auto base = static_cast<float>(settings.cap_base);
     if (settings.cap_keyword) {
-      // const auto effects = core::utility::get_active_effects_by_keyword(actor, settings.cap_keyword);
-      // base += core::utility::get_magnitude_sum_of_active_effects(&effects);
-      base += core::utility::get_sum_of_active_effects_magnitude_with_keyword(actor, settings.cap_keyword);
+      base += get_effect_input(actor, snapshot, effect_input::cap, type);
     }
     return static_cast<int>((std::max)(0.f, base));
   }
 
-  float calculate_cooldown(RE::Actor* actor, const config::flask_settings_base& settings)
+  float calculate_cooldown(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                           const config::flask_settings_base& settings, const flask_type type)
   {
     auto base = settings.cooldown_base;
     if (settings.cooldown_keyword) {
-      // const auto effects = core::utility::get_active_effects_by_keyword(actor, settings.cooldown_keyword);
-      // base += core::utility::get_magnitude_sum_of_active_effects(&effects);
-      base += core::utility::get_sum_of_active_effects_magnitude_with_keyword(actor, settings.cooldown_keyword);
+      base += get_effect_input(actor, snapshot, effect_input::cooldown, type);
     }
     return (std::max)(0.f, base);
   }
 
-  float calculate_regen_mult(RE::Actor* actor, const config::flask_settings_base& settings)
+  float calculate_regen_mult_raw(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                                 const config::flask_settings_base& settings, const flask_type type)
   {
     auto base = settings.regeneration_mult_base;
     if (settings.regeneration_mult_keyword) {
-      // const auto effects = core::utility::get_active_effects_by_keyword(actor, settings.regeneration_mult_keyword);
-      // base += core::utility::get_magnitude_sum_of_active_effects(&effects);
-      base += core::utility::get_sum_of_active_effects_magnitude_with_keyword(actor, settings.regeneration_mult_keyword);
+      base += get_effect_input(actor, snapshot, effect_input::regen, type);
     }
-    return (std::max)(0.f, base) / 100.0f;
+    return (std::max)(0.f, base);
   }
 
-  float calculate_regen_mult_raw(RE::Actor* actor, const config::flask_settings_base& settings)
+  float calculate_regen_mult(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                             const config::flask_settings_base& settings, const flask_type type)
   {
-    auto base = settings.regeneration_mult_base;
-    if (settings.regeneration_mult_keyword) {
-      // const auto effects = core::utility::get_active_effects_by_keyword(actor, settings.regeneration_mult_keyword);
-      // base += core::utility::get_magnitude_sum_of_active_effects(&effects);
-      base += core::utility::get_sum_of_active_effects_magnitude_with_keyword(actor, settings.regeneration_mult_keyword);
-    }
-    return (std::max)(0.f, base);
+    return calculate_regen_mult_raw(actor, snapshot, settings, type) / 100.0f;
   }
 
-  int count_available_flasks(RE::Actor* actor, core::actors_cache::cache_data::actor_data::flask_cooldown* flasks, const flask_type type, const int max_slots)
+  int count_available_flasks(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                              const core::actors_cache::cache_data::actor_data::flask_cooldown* flasks,
+                              const flask_type type, const int max_slots)
   {
     if (!flasks) return 0;
 
     int available = 0;
     const int limit = get_slot_limit(max_slots);
-    if (is_in_inventory_mod_use(actor, type)) {
-      auto settings = get_settings(config::config_manager::get_singleton(), type);
-      auto potion_count = get_potions_count(actor, *settings, type);
+    if (is_in_inventory_mod_use(actor, snapshot, type)) {
+      auto potion_count = get_potions_count(actor, snapshot, type);
       if (potion_count > limit) {
         return limit;
       }
@@ -307,7 +447,8 @@ namespace features::true_flasks
     return available;
   }
 
-  int count_recharging_flasks(core::actors_cache::cache_data::actor_data::flask_cooldown* flasks, const int max_slots)
+  int count_recharging_flasks(const core::actors_cache::cache_data::actor_data::flask_cooldown* flasks,
+                              const int max_slots)
   {
     if (!flasks) return 0;
 
@@ -323,19 +464,20 @@ namespace features::true_flasks
     return recharging;
   }
 
-  bool consume_flask_slots(RE::Actor* actor, core::actors_cache::cache_data::actor_data::flask_cooldown* flasks, const flask_type type,
+  bool consume_flask_slots(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                           core::actors_cache::cache_data::actor_data::flask_cooldown* flasks, const flask_type type,
                            const float cooldown_duration, const int max_slots, const int count)
   {
     if (!flasks || count <= 0) return false;
 
     const int limit = get_slot_limit(max_slots);
-    if (limit <= 0 || count_available_flasks(actor, flasks, type, limit) < count) {
+    if (limit <= 0 || count_available_flasks(actor, snapshot, flasks, type, limit) < count) {
       return false;
     }
     
-    if (is_in_inventory_mod_use(actor, type)) {
-      const auto settings = get_settings(config::config_manager::get_singleton(), type);
-      auto* potion = get_selected_inventory_potion(actor, *settings, type, false);
+    if (is_in_inventory_mod_use(actor, snapshot, type)) {
+      const auto settings = get_settings(&snapshot->values, type);
+      auto* potion = get_selected_inventory_potion(actor, snapshot, *settings, type, false);
       if (!potion) {
         return false;
       }
@@ -406,29 +548,20 @@ namespace features::true_flasks
   core::actors_cache::cache_data::actor_data::flask_cooldown* get_flasks_array(
     core::actors_cache::cache_data::actor_data& data, const flask_type type)
   {
-    switch (type) {
-    case flask_type::Health: return data.flasks_health;
-    case flask_type::Stamina: return data.flasks_stamina;
-    case flask_type::Magick: return data.flasks_magick;
-    case flask_type::Other: return data.flasks_others;
-    }
-    return nullptr;
+    return data.get_flasks(static_cast<int>(type));
   }
 
-  // Forward declarations needed because API accessors are defined later
-  export auto api_get_max_slots(RE::Actor* actor, const flask_type type) -> int;
-  export auto api_get_current_slots(RE::Actor* actor, const flask_type type) -> int;
-  
-  auto get_potion_max_magnitude_with_keyword(RE::AlchemyItem* potion, const RE::BGSKeyword* keyword) -> float
+  auto get_potion_max_magnitude_with_keyword(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                                             const core::keyword_index::keyword_mask& keyword) -> float
   {
     auto result = 0.f;
     auto found = false;
-    if (!potion || !keyword) {
+    if (!potion || keyword.none()) {
       return 0.f;
     }
     
     for (const auto effect : potion->effects) {
-      if (!effect || !effect->baseEffect || !effect->baseEffect->HasKeyword(keyword)) {
+      if (!effect || !effect->baseEffect || (get_effect_mask(effect->baseEffect, snapshot) & keyword).none()) {
         continue;
       }
 
@@ -444,19 +577,20 @@ namespace features::true_flasks
     return found ? result : 0.f;
   }
 
-  auto get_potion_restore_count_with_keyword(RE::AlchemyItem* potion, const RE::BGSKeyword* keyword) -> int
+  auto get_potion_restore_count_with_keyword(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                                             const core::keyword_index::keyword_mask& keyword) -> int
   {
-    if (!potion || !keyword) {
+    if (!potion || keyword.none()) {
       return 0;
     }
 
-    auto magnitude = get_potion_max_magnitude_with_keyword(potion, keyword);
+    auto magnitude = get_potion_max_magnitude_with_keyword(potion, snapshot, keyword);
     if (magnitude > 0.f) {
       return (std::max)(1, static_cast<int>(magnitude));
     }
 
     for (const auto effect : potion->effects) {
-      if (!effect || !effect->baseEffect || !effect->baseEffect->HasKeyword(keyword)) {
+      if (!effect || !effect->baseEffect || (get_effect_mask(effect->baseEffect, snapshot) & keyword).none()) {
         continue;
       }
 
@@ -526,79 +660,201 @@ namespace features::true_flasks
     return result;
   }
 
-  bool is_flask_potion(RE::AlchemyItem* potion)
+  bool is_flask_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot)
   {
     if (!potion) {
       return false;
     }
 
-    const auto* config = config::config_manager::get_singleton();
-    if (!config) {
-      return false;
-    }
-
-    if (config->main.no_remove_keyword && core::utility::try_form_has_keyword(potion, config->main.no_remove_keyword)) {
-      return true;
-    }
-
-    if (config->flasks_health.keyword && core::utility::try_form_has_keyword(potion, config->flasks_health.keyword)) {
-      return true;
-    }
-    if (config->flasks_stamina.keyword && core::utility::try_form_has_keyword(potion, config->flasks_stamina.keyword)) {
-      return true;
-    }
-    if (config->flasks_magick.keyword && core::utility::try_form_has_keyword(potion, config->flasks_magick.keyword)) {
-      return true;
-    }
-
-    return false;
+    return (get_potion_masks(potion, snapshot).own & (snapshot->no_remove | snapshot->flask_keywords)).any();
   }
 
-  bool is_valid_inventory_use_potion(RE::AlchemyItem* potion, const config::flask_settings_base& settings,
-                                     const flask_type type)
+  bool is_valid_inventory_use_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                                     const config::flask_settings_base& settings, const flask_type type)
   {
-    if (!potion || !settings.inventory_keyword || type == flask_type::Other) {
+    if (!potion || !settings.inventory_keyword || type >= flask_type::Other) {
       return false;
     }
 
-    if (is_flask_potion(potion)) {
+    if (is_flask_potion(potion, snapshot)) {
       return false;
     }
 
-    if (!try_potion_has_keyword(potion, settings.inventory_keyword)) {
+    if (!try_potion_has_keyword(potion, snapshot, get_type_masks(snapshot, type).inventory)) {
       return false;
     }
 
     return get_potion_max_magnitude_with_actor_value(potion, get_av_by_flask_type(type)) > 0.f;
   }
 
-  bool is_valid_inventory_deposit_potion(RE::AlchemyItem* potion, const config::flask_settings_base& settings)
+  bool is_valid_inventory_deposit_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                                         const config::flask_settings_base& settings, const flask_type type)
   {
     if (!potion || !settings.inventory_keyword) {
       return false;
     }
 
-    if (is_flask_potion(potion)) {
+    if (is_flask_potion(potion, snapshot)) {
       return false;
     }
 
-    return get_potion_restore_count_with_keyword(potion, settings.inventory_keyword) > 0;
+    return get_potion_restore_count_with_keyword(potion, snapshot, get_type_masks(snapshot, type).inventory) > 0;
   }
 
-  RE::AlchemyItem* get_selected_inventory_potion(RE::Actor* actor, const config::flask_settings_base& settings,
-                                                 const flask_type type, const bool for_deposit)
+  // Eligible potions of one flask type and purpose in the player's inventory, ordered by their precomputed
+  // magnitude (restore count for deposits). Built with one inventory pass, then kept current per item from
+  // container change events, so picking the weakest, strongest or first found potion needs no inventory scan.
+  class potion_ranking
   {
-    if (!actor || !settings.inventory_keyword) {
+  public:
+    struct entry
+    {
+      RE::AlchemyItem* potion;
+      int count;
+      float magnitude;
+    };
+
+  private:
+    // Ties are broken by the order potions were first seen, which is also the first found order.
+    using rank_key = std::pair<float, std::uint64_t>;
+
+    std::map<rank_key, entry> ranked_;
+    std::map<std::uint64_t, rank_key> order_;
+    std::unordered_map<RE::FormID, rank_key> keys_;
+    std::uint64_t next_order_{0};
+
+  public:
+    void clear()
+    {
+      ranked_.clear();
+      order_.clear();
+      keys_.clear();
+      next_order_ = 0;
+    }
+
+    [[nodiscard]] auto contains(const RE::FormID form_id) const -> bool
+    {
+      return keys_.contains(form_id);
+    }
+
+    void insert(RE::AlchemyItem* potion, const int count, const float magnitude)
+    {
+      const rank_key key{magnitude, next_order_++};
+      ranked_.emplace(key, entry{potion, count, magnitude});
+      order_.emplace(key.second, key);
+      keys_.emplace(potion->GetFormID(), key);
+    }
+
+    // Sets the count of a known potion, a count of zero removes it.
+    void update_count(const RE::FormID form_id, const int count)
+    {
+      const auto it = keys_.find(form_id);
+      if (it == keys_.end()) {
+        return;
+      }
+
+      const auto key = it->second;
+      auto& ranked = ranked_.at(key);
+      if (count > 0) {
+        ranked.count = count;
+        return;
+      }
+
+      ranked_.erase(key);
+      order_.erase(key.second);
+      keys_.erase(it);
+    }
+
+    [[nodiscard]] auto select(const inventory_select_mode mode) const -> RE::AlchemyItem*
+    {
+      if (ranked_.empty()) {
+        return nullptr;
+      }
+
+      switch (mode) {
+      case inventory_select_mode::weakest_first:
+        return ranked_.begin()->second.potion;
+      case inventory_select_mode::strongest_first:
+        return ranked_.lower_bound({std::prev(ranked_.end())->first.first, 0})->second.potion;
+      default:
+        return ranked_.at(order_.begin()->second).potion;
+      }
+    }
+
+    // Entries in first found order.
+    [[nodiscard]] auto entries(std::pmr::memory_resource* resource) const -> std::pmr::vector<entry>
+    {
+      std::pmr::vector<entry> result(resource);
+      result.reserve(order_.size());
+      for (const auto& key : order_ | std::views::values) {
+        result.push_back(ranked_.at(key));
+      }
+      return result;
+    }
+  };
+
+  constexpr int kRankedTypeCount = kFlaskTypeCount + kFlaskCategoryMaxCount;
+
+  // Rankings for the player, one per flask type and purpose. Inventory modes are player only.
+  struct potion_rankings
+  {
+    std::mutex mutex;
+    std::uint64_t version{0};
+    std::array<potion_ranking, kRankedTypeCount * 2> rankings;
+    std::array<bool, kRankedTypeCount * 2> built{};
+  };
+
+  potion_rankings& get_potion_rankings()
+  {
+    static potion_rankings rankings;
+    return rankings;
+  }
+
+  bool is_ranked_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                        const config::flask_settings_base& settings, const flask_type type,
+                        const inventory_purpose purpose)
+  {
+    return purpose == inventory_purpose::deposit ? is_valid_inventory_deposit_potion(potion, snapshot, settings, type)
+                                                 : is_valid_inventory_use_potion(potion, snapshot, settings, type);
+  }
+
+  float get_ranked_magnitude(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot,
+                             const config::flask_settings_base& settings, const flask_type type,
+                             const inventory_purpose purpose)
+  {
+    return purpose == inventory_purpose::deposit
+             ? static_cast<float>(
+                 get_potion_restore_count_with_keyword(potion, snapshot, get_type_masks(snapshot, type).inventory))
+             : get_potion_max_magnitude_with_actor_value(potion, get_av_by_flask_type(type));
+  }
+
+  // Returns the ranking of the type and purpose, built on first use after a reset. Requires the rankings lock.
+  potion_ranking* get_potion_ranking_locked(potion_rankings& rankings, RE::Actor* actor,
+                                            const config::settings_snapshot* snapshot,
+                                            const config::flask_settings_base& settings, const flask_type type,
+                                            const inventory_purpose purpose)
+  {
+    const auto type_index = static_cast<int>(type);
+    if (!actor || !actor->IsPlayerRef() || type_index < 0 || type_index >= kRankedTypeCount) {
       return nullptr;
     }
 
+    if (rankings.version != snapshot->version) {
+      rankings.version = snapshot->version;
+      rankings.built.fill(false);
+    }
+
+    const auto index = type_index * 2 + static_cast<int>(purpose);
+    auto& ranking = rankings.rankings[index];
+    if (rankings.built[index]) {
+      return &ranking;
+    }
+
+    ranking.clear();
+    core::telemetry::telemetry::get_singleton()->add(core::telemetry::metric::inventory_scans);
     const auto inventory = actor->GetInventory([](RE::TESBoundObject& object) {
       return object.GetFormType() == RE::FormType::AlchemyItem;
     });
-
-    RE::AlchemyItem* selected = nullptr;
-    float selected_magnitude = 0.f;
-
     for (const auto& [item, inv_data] : inventory) {
       const auto& [count, entry] = inv_data;
       if (count <= 0 || !entry) {
@@ -607,42 +863,83 @@ namespace features::true_flasks
 
       auto* potion = item ? item->As<RE::AlchemyItem>() : nullptr;
       const auto actual_count = get_actual_item_count(actor, potion, count);
-      if (actual_count <= 0) {
+      if (actual_count <= 0 || !is_ranked_potion(potion, snapshot, settings, type, purpose)) {
         continue;
       }
+      ranking.insert(potion, actual_count, get_ranked_magnitude(potion, snapshot, settings, type, purpose));
+    }
+    rankings.built[index] = true;
+    return &ranking;
+  }
 
-      const auto is_valid = for_deposit
-                              ? is_valid_inventory_deposit_potion(potion, settings)
-                              : is_valid_inventory_use_potion(potion, settings, type);
-      if (!is_valid) {
-        continue;
-      }
+  RE::AlchemyItem* select_ranked_potion(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                                        const config::flask_settings_base& settings, const flask_type type,
+                                        const inventory_purpose purpose)
+  {
+    auto& rankings = get_potion_rankings();
+    std::lock_guard<std::mutex> lock(rankings.mutex);
+    const auto ranking = get_potion_ranking_locked(rankings, actor, snapshot, settings, type, purpose);
+    return ranking ? ranking->select(settings.inventory_select_mode_value) : nullptr;
+  }
+
+  std::pmr::vector<potion_ranking::entry> get_ranked_potions(RE::Actor* actor,
+                                                             const config::settings_snapshot* snapshot,
+                                                             const config::flask_settings_base& settings,
+                                                             const flask_type type, const inventory_purpose purpose,
+                                                             std::pmr::memory_resource* resource)
+  {
+    auto& rankings = get_potion_rankings();
+    std::lock_guard<std::mutex> lock(rankings.mutex);
+    const auto ranking = get_potion_ranking_locked(rankings, actor, snapshot, settings, type, purpose);
+    return ranking ? ranking->entries(resource) : std::pmr::vector<potion_ranking::entry>(resource);
+  }
+
+  // Brings every built ranking up to date for one potion whose count in the player's inventory changed.
+  void update_ranked_potion(RE::AlchemyItem* potion, const config::settings_snapshot* snapshot, const int count)
+  {
+    auto& rankings = get_potion_rankings();
+    std::lock_guard<std::mutex> lock(rankings.mutex);
+    if (rankings.version != snapshot->version) {
+      return;
+    }
 
-      if (settings.inventory_select_mode_value == inventory_select_mode::first_found) {
-        return potion;
+    for (const int index : std::views::iota(0, kRankedTypeCount * 2)) {
+      if (!rankings.built[index]) {
+        continue;
       }
 
-      const auto magnitude = for_deposit
-                               ? static_cast<float>(get_potion_restore_count_with_keyword(potion, settings.inventory_keyword))
-                               : get_potion_max_magnitude_with_actor_value(potion, get_av_by_flask_type(type));
-      if (!selected) {
-        selected = potion;
-        selected_magnitude = magnitude;
+      auto& ranking = rankings.rankings[index];
+      if (ranking.contains(potion->GetFormID())) {
+        ranking.update_count(potion->GetFormID(), count);
         continue;
       }
 
-      if (settings.inventory_select_mode_value == inventory_select_mode::weakest_first) {
-        if (magnitude < selected_magnitude) {
-          selected = potion;
-          selected_magnitude = magnitude;
-        }
-      } else if (magnitude > selected_magnitude) {
-        selected = potion;
-        selected_magnitude = magnitude;
+      const auto type = static_cast<flask_type>(index / 2);
+      const auto purpose = static_cast<inventory_purpose>(index % 2);
+      const auto settings = get_settings(&snapshot->values, type);
+      if (count > 0 && settings && is_ranked_potion(potion, snapshot, *settings, type, purpose)) {
+        ranking.insert(potion, count, get_ranked_magnitude(potion, snapshot, *settings, type, purpose));
       }
     }
+  }
+
+  void reset_potion_rankings()
+  {
+    auto& rankings = get_potion_rankings();
+    std::lock_guard<std::mutex> lock(rankings.mutex);
+    rankings.built.fill(false);
+  }
+
+  RE::AlchemyItem* get_selected_inventory_potion(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                                                 const config::flask_settings_base& settings, const flask_type type,
+                                                 const bool for_deposit)
+  {
+    if (!actor || !settings.inventory_keyword) {
+      return nullptr;
+    }
 
-    return selected;
+    return select_ranked_potion(actor, snapshot, settings, type,
+                                for_deposit ? inventory_purpose::deposit : inventory_purpose::use);
   }
 
   bool consume_pending_inventory_drink(RE::Actor* actor, const RE::AlchemyItem* potion)
@@ -661,65 +958,322 @@ namespace features::true_flasks
     return false;
   }
   
-  bool consume_flask_slot(const flask_type type, RE::Actor* actor, const int count)
+  // slot_limits is only needed for SlotReady, which the frame tick reports when there are subscribers.
+  core::actors_cache::cache_data::actor_data::delta_data make_delta_data(RE::Actor* actor,
+                                                                         const config::settings_snapshot* snapshot,
+                                                                         const float delta,
+                                                                         const bool slot_limits = false)
+  {
+    const auto config = &snapshot->values;
+
+    auto d_data = core::actors_cache::cache_data::actor_data::delta_data{};
+    d_data.delta = delta;
+    d_data.category_count = (std::min)(static_cast<int>(config->categories.size()), kFlaskCategoryMaxCount);
+
+    for (const int i : std::views::iota(0, kFlaskTypeCount + d_data.category_count)) {
+      const auto settings = get_settings(config, static_cast<flask_type>(i));
+      d_data.deltas[i] = delta * calculate_regen_mult(actor, snapshot, *settings, static_cast<flask_type>(i));
+      d_data.parallel[i] = settings->enable_parallel_cooldown;
+      // Inventory use mode never starts cooldowns, so its limit does not matter and its potion count is not taken.
+      if (slot_limits && !is_in_inventory_mod_use(actor, snapshot, static_cast<flask_type>(i))) {
+        d_data.slot_limits[i] = static_cast<std::uint8_t>(
+          get_slot_limit(calculate_max_slots(actor, snapshot, *settings, static_cast<flask_type>(i))));
+      }
+    }
+
+    return d_data;
+  }
+
+  // Gaps below this many real seconds are regular frame jitter and are left to the frame ticks.
+  constexpr float kGameTimeCatchUpThreshold = 1.0f;
+
+  // Converts the game time passed since the actor's last sync into real seconds and applies the part
+  // that frame ticks did not cover (waiting, sleeping, fast travel) as a single catch-up step.
+  // frame_delta is the time already ticked this frame, zero when called from a write outside the frame
+  // tick. Queries never sync, see find_actor_data().
+  void sync_game_time(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                      core::actors_cache::cache_data::actor_data& actor_data, const float frame_delta)
+  {
+    if (!actor || (!snapshot->values.main.game_time_catch_up && !actor_data.pending_catch_up)) {
+      return;
+    }
+
+    const auto calendar = RE::Calendar::GetSingleton();
+    if (!calendar) {
+      return;
+    }
+    actor_data.pending_catch_up = false;
+
+    const auto hours = calendar->GetHoursPassed();
+    const auto timescale = calendar->GetTimescale();
+    if (actor_data.last_game_hours < 0.f || hours < actor_data.last_game_hours || timescale <= 0.f) {
+      actor_data.last_game_hours = hours;
+      return;
+    }
+
+    const auto elapsed = (hours - actor_data.last_game_hours) * 3600.f / timescale;
+    const auto gap = elapsed - frame_delta;
+    if (gap < kGameTimeCatchUpThreshold) {
+      // Writes outside the frame tick keep the old stamp so that the next frame tick is not counted twice.
+      if (frame_delta > 0.f) {
+        actor_data.last_game_hours = hours;
+      }
+      return;
+    }
+
+    actor_data.last_game_hours = hours;
+    actor_data.catch_up(make_delta_data(actor, snapshot, gap));
+    logger::info("Game time catch-up: actor {:08X}, {:.1f} s", actor->GetFormID(), gap);
+  }
+
+  // Frame ticks recorded in the actor table by the actor updates and applied together as one sweep over the table.
+  // Everything that needs the engine (regen multipliers from active effects, game time) is done when the actor
+  // updates; the sweep itself is only cooldown arithmetic on each actor's own slot.
+  struct actor_tick_batch final
+  {
+    std::mutex mutex;
+    // Bit per type whose recharging count dropped, per table slot, filled by the sweep.
+    std::vector<std::uint64_t> ready_masks;
+    // Actors with slots that became ready, reported as events on the main thread.
+    std::vector<std::pair<RE::FormID, std::uint64_t>> ready;
+  };
+  static_assert(kFlaskTypeCount + kFlaskCategoryMaxCount <= 64);
+
+  actor_tick_batch g_actor_ticks;
+
+  using actor_table_chunk = core::actors_cache::cache_data::table_chunk;
+
+  // Returns the types whose recharging count within the recorded slot limit dropped, or 0 if track_ready is off.
+  // Slots past the cap keep ticking but are not usable, so one of them finishing is not a ready slot.
+  std::uint64_t run_actor_tick(core::actors_cache::cache_data::actor_data& actor_data,
+                               const core::actors_cache::cache_data::actor_data::delta_data& delta_data,
+                               const int type_count, const bool track_ready)
+  {
+    // Read through find_flasks so categories the actor never touched stay unallocated.
+    std::array<int, kFlaskTypeCount + kFlaskCategoryMaxCount> recharging_before{};
+    if (track_ready) {
+      for (const int index : std::views::iota(0, type_count)) {
+        recharging_before[index] =
+          count_recharging_flasks(actor_data.find_flasks(index), delta_data.slot_limits[index]);
+      }
+    }
+
+    actor_data.update(delta_data);
+
+    std::uint64_t ready_mask = 0;
+    if (!track_ready) {
+      return ready_mask;
+    }
+
+    for (const int index : std::views::iota(0, type_count)) {
+      if (count_recharging_flasks(actor_data.find_flasks(index), delta_data.slot_limits[index]) <
+          recharging_before[index]) {
+        ready_mask |= std::uint64_t{1} << index;
+      }
+    }
+    return ready_mask;
+  }
+
+  // Applies the recorded ticks. Main thread only, from flush_actor_ticks(): the player's slot is read there without
+  // the cache lock, so nothing else may write it. The caller must hold g_actor_ticks.mutex.
+  void apply_actor_ticks(const config::settings_snapshot* snapshot)
+  {
+    auto& batch = g_actor_ticks;
+    const auto type_count = get_flask_type_count(&snapshot->values);
+    const auto track_ready = api::mod_api::has_flask_event_subscribers();
+
+    core::actors_cache::cache_data::get_singleton()->sweep_seen(
+      [&](const std::span<const std::unique_ptr<actor_table_chunk>> chunks) {
+        batch.ready_masks.assign(chunks.size() * actor_table_chunk::SIZE, 0);
+
+        // One chunk per pool task, each walks its marked slots in table order.
+        core::thread_pool::thread_pool::get_singleton()->parallel_for(
+          chunks.size(), 1, [&](const std::size_t begin, const std::size_t end) {
+            for (auto c = begin; c < end; ++c) {
+              auto& chunk = *chunks[c];
+              for (auto mask = chunk.seen_mask; mask != 0; mask &= mask - 1) {
+                const auto offset = static_cast<std::size_t>(std::countr_zero(mask));
+                batch.ready_masks[c * actor_table_chunk::SIZE + offset] =
+                  run_actor_tick(chunk.actors[offset], chunk.deltas[offset], type_count, track_ready);
+              }
+            }
+          });
+
+        if (!track_ready) {
+          return;
+        }
+        for (std::size_t slot = 0; slot < batch.ready_masks.size(); ++slot) {
+          if (const auto mask = batch.ready_masks[slot]; mask != 0) {
+            batch.ready.emplace_back(chunks[slot / actor_table_chunk::SIZE]->form_ids[slot % actor_table_chunk::SIZE],
+                                     mask);
+          }
+        }
+      });
+  }
+
+  // Cache access for reads and writes outside the frame tick, brings the actor up to the current game time first.
+  // Frame ticks still waiting are applied by the next flush, so the slots may lag by up to one frame.
+  core::actors_cache::cache_data::actor_data& get_actor_data(RE::Actor* actor,
+                                                             const config::settings_snapshot* snapshot)
+  {
+    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
+    sync_game_time(actor, snapshot, actor_data, 0.f);
+    return actor_data;
+  }
+
+  // Holds a cold actor's state for the duration of a query.
+  using actor_data_scratch = std::optional<core::actors_cache::cache_data::actor_data>;
+
+  // Read-only counterpart of get_actor_data(): nullptr for an actor without state, which is then read as having
+  // every slot ready. Queries have no side effects: nothing is added, promoted, ticked or caught up; the frame
+  // update and flush_actor_ticks() do that.
+  const core::actors_cache::cache_data::actor_data* find_actor_data(RE::Actor* actor, actor_data_scratch& scratch)
+  {
+    return core::actors_cache::cache_data::get_singleton()->find(actor->GetFormID(), scratch);
+  }
+
+  // Slots of an actor or category without state: all ready.
+  const std::array<core::actors_cache::cache_data::actor_data::flask_cooldown, kFlaskMaxCount> kReadyFlasks{};
+
+  const core::actors_cache::cache_data::actor_data::flask_cooldown* read_flasks_array(
+    const core::actors_cache::cache_data::actor_data* data, const config::settings_snapshot* snapshot,
+    const flask_type type)
+  {
+    if (!is_valid_flask_type(snapshot, type)) {
+      return nullptr;
+    }
+    if (data) {
+      if (const auto flasks = data->find_flasks(static_cast<int>(type))) {
+        return flasks;
+      }
+    }
+    return kReadyFlasks.data();
+  }
+
+  // Negative cache for the update hook: whether any flask type is enabled for the player or for NPCs. Eligibility
+  // depends on nothing but the settings, so the verdict per side is cached against the settings version.
+  std::atomic<std::uint64_t> g_flask_user_verdict{0};
+
+  bool is_flask_user(RE::Actor* actor, const config::settings_snapshot* snapshot)
+  {
+    constexpr std::uint64_t kPlayerBit = 1;
+    constexpr std::uint64_t kNpcBit = 2;
+
+    auto verdict = g_flask_user_verdict.load(std::memory_order_acquire);
+    if (verdict >> 2 != snapshot->version) {
+      verdict = snapshot->version << 2;
+      for (const int index : std::views::iota(0, get_flask_type_count(&snapshot->values))) {
+        const auto settings = get_settings(&snapshot->values, static_cast<flask_type>(index));
+        if (settings && settings->enable) {
+          verdict |= (settings->player ? kPlayerBit : 0) | (settings->npc ? kNpcBit : 0);
+        }
+      }
+      g_flask_user_verdict.store(verdict, std::memory_order_release);
+    }
+
+    return (verdict & (core::utility::is_player(actor) ? kPlayerBit : kNpcBit)) != 0;
+  }
+
+  // Queues a flask event for API subscribers. A change of max slots since the last event of this type
+  // is reported first as CapChanged; passing CapChanged itself only reports such a change.
+  // Does nothing when no plugin subscribed.
+  void queue_flask_event(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                         core::actors_cache::cache_data::actor_data& actor_data,
+                         const TrueFlasksAPI::FlaskEventType event, const flask_type type, const int max_slots,
+                         const TrueFlasksAPI::DrinkBlockedReason reason = TrueFlasksAPI::DrinkBlockedReason::None)
+  {
+    if (!actor || !is_valid_flask_type(snapshot, type) || !api::mod_api::has_flask_event_subscribers()) {
+      return;
+    }
+
+    const auto last_max_slots_ptr = actor_data.get_last_max_slots(static_cast<int>(type));
+    if (!last_max_slots_ptr) {
+      return;
+    }
+    auto& last_max_slots = *last_max_slots_ptr;
+    const auto cap_changed = last_max_slots >= 0 && last_max_slots != max_slots;
+    last_max_slots = max_slots;
+    if (!cap_changed && event == TrueFlasksAPI::FlaskEventType::CapChanged) {
+      return;
+    }
+
+    const auto current_slots =
+      count_available_flasks(actor, snapshot, get_flasks_array(actor_data, type), type, max_slots);
+    if (cap_changed) {
+      api::mod_api::push_flask_event({TrueFlasksAPI::FlaskEventType::CapChanged, type,
+                                      TrueFlasksAPI::DrinkBlockedReason::None, actor->GetFormID(), current_slots,
+                                      max_slots});
+    }
+    if (event != TrueFlasksAPI::FlaskEventType::CapChanged) {
+      api::mod_api::push_flask_event({event, type, reason, actor->GetFormID(), current_slots, max_slots});
+    }
+  }
+
+  bool consume_flask_slot(const flask_type type, RE::Actor* actor, const config::settings_snapshot* snapshot,
+                          const int count)
   {
-    if (!actor || !is_valid_flask_type(type) || count <= 0) {
+    if (!actor || !is_valid_flask_type(snapshot, type) || count <= 0) {
       return false;
     }
     
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
-    const auto settings = get_settings(config::config_manager::get_singleton(), type);
+    auto& actor_data = get_actor_data(actor, snapshot);
+    const auto settings = get_settings(&snapshot->values, type);
     if (!settings) {
       return false;
     }
     
-    const auto max_slots = calculate_max_slots(actor, *settings, type);
-    const auto cooldown = calculate_cooldown(actor, *settings);
+    const auto max_slots = calculate_max_slots(actor, snapshot, *settings, type);
+    const auto cooldown = calculate_cooldown(actor, snapshot, *settings, type);
 
     auto flasks = get_flasks_array(actor_data, type);
 
-    if (consume_flask_slots(actor, flasks, type, cooldown, max_slots, count)) {
+    if (consume_flask_slots(actor, snapshot, flasks, type, cooldown, max_slots, count)) {
       logger::info("Consumed {} flask slot(s): type {}, cooldown {:.1f}, slots {}/{}", count,
                    static_cast<int>(type), cooldown,
-                   api_get_current_slots(actor, type), max_slots);
+                   count_available_flasks(actor, snapshot, flasks, type, max_slots), max_slots);
+      queue_flask_event(actor, snapshot, actor_data, TrueFlasksAPI::FlaskEventType::SlotConsumed, type, max_slots);
       return true;
     }
     
     return false;
   }
   
-  bool restore_flask_slot(const flask_type type, RE::Actor* actor, const int count)
+  bool restore_flask_slot(const flask_type type, RE::Actor* actor, const config::settings_snapshot* snapshot,
+                          const int count)
   {
-    if (!actor || !is_valid_flask_type(type) || count <= 0) {
+    if (!actor || !is_valid_flask_type(snapshot, type) || count <= 0) {
       return false;
     }
     
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
-    const auto settings = get_settings(config::config_manager::get_singleton(), type);
+    auto& actor_data = get_actor_data(actor, snapshot);
+    const auto settings = get_settings(&snapshot->values, type);
     if (!settings) {
       return false;
     }
 
-    const auto max_slots = calculate_max_slots(actor, *settings, type);
+    const auto max_slots = calculate_max_slots(actor, snapshot, *settings, type);
     auto flasks = get_flasks_array(actor_data, type);
 
     if (restore_flask_slots(flasks, max_slots, count)) {
       logger::info("Restored {} flask slot(s): type {}, slots {}/{}", count, static_cast<int>(type),
-                   api_get_current_slots(actor, type), max_slots);
+                   count_available_flasks(actor, snapshot, flasks, type, max_slots), max_slots);
+      queue_flask_event(actor, snapshot, actor_data, TrueFlasksAPI::FlaskEventType::SlotRestored, type, max_slots);
       return true;
     }
     
     return false;
   }
 
-  void try_inventory_deposit(RE::Actor* actor, core::actors_cache::cache_data::actor_data& actor_data,
+  // Takes the deposit potions from the ranking, then every planned potion is removed with a single call.
+  void try_inventory_deposit(RE::Actor* actor, const config::settings_snapshot* snapshot,
+                             core::actors_cache::cache_data::actor_data& actor_data,
                              const config::flask_settings_base& settings, const flask_type type)
   {
-    if (!actor) {
+    if (!actor || !settings.inventory_keyword) {
       return;
     }
 
-    const auto max_slots = calculate_max_slots(actor, settings, type);
+    const auto max_slots = calculate_max_slots(actor, snapshot, settings, type);
     if (max_slots <= 0) {
       return;
     }
@@ -729,27 +1283,35 @@ namespace features::true_flasks
       return;
     }
 
-    auto current_slots = count_available_flasks(actor, flasks, type, max_slots);
-    while (current_slots < max_slots) {
-      auto* potion = get_selected_inventory_potion(actor, settings, type, true);
-      if (!potion) {
-        break;
-      }
+    const auto current_slots = count_available_flasks(actor, snapshot, flasks, type, max_slots);
+    if (current_slots >= max_slots) {
+      return;
+    }
 
-      const auto restore_count = get_potion_restore_count_with_keyword(potion, settings.inventory_keyword);
-      if (restore_count <= 0) {
-        break;
-      }
+    // Scratch lists live in the frame arena.
+    const auto arena = core::frame_arena::frame_arena::get_singleton()->resource();
+    std::pmr::vector<core::deposit_plan::candidate<RE::AlchemyItem*>> candidates(arena);
+    for (const auto& entry : get_ranked_potions(actor, snapshot, settings, type, inventory_purpose::deposit, arena)) {
+      candidates.push_back({entry.potion, entry.count, static_cast<int>(entry.magnitude)});
+    }
 
-      const auto restore_amount = (std::min)(max_slots - current_slots, restore_count);
-      if (!restore_flask_slots(flasks, max_slots, restore_amount)) {
+    const auto plan =
+      core::deposit_plan::plan(std::move(candidates), max_slots - current_slots,
+                               static_cast<core::deposit_plan::select_order>(settings.inventory_select_mode_value));
+    auto restored = false;
+    for (const auto& step : plan) {
+      if (!restore_flask_slots(flasks, max_slots, step.slots_restored)) {
         break;
       }
+      restored = true;
+
+      logger::info("Inventory deposit restored {} slot(s): type {}, potion {} x{}", step.slots_restored,
+                   static_cast<int>(type), step.potion->GetName(), step.potions_used);
+      actor->RemoveItem(step.potion, step.potions_used, RE::ITEM_REMOVE_REASON::kRemove, nullptr, nullptr);
+    }
 
-      logger::info("Inventory deposit restored {} slot(s): type {}, potion {}, missing_before {}",
-                   restore_amount, static_cast<int>(type), potion->GetName(), max_slots - current_slots);
-      current_slots += restore_amount;
-      actor->RemoveItem(potion, 1, RE::ITEM_REMOVE_REASON::kRemove, nullptr, nullptr);
+    if (restored) {
+      queue_flask_event(actor, snapshot, actor_data, TrueFlasksAPI::FlaskEventType::SlotRestored, type, max_slots);
     }
   }
 
@@ -767,8 +1329,8 @@ namespace features::true_flasks
       return true;
     }
 
-    const auto config = config::config_manager::get_singleton();
-    const auto type_opt = identify_flask_type(ctx.potion, config);
+    const auto snapshot = config::current_snapshot();
+    const auto type_opt = classify_potion(ctx.potion, snapshot.get());
 
     if (!type_opt.has_value()) {
       logger::info("Potion not identified as flask: {}", ctx.potion->GetName());
@@ -776,14 +1338,15 @@ namespace features::true_flasks
     }
 
     const auto type = type_opt.value();
-    const auto settings = get_settings(config, type);
+    const auto settings = get_settings(&snapshot->values, type);
 
-    if (!settings->enable) {
+    if (!settings || !settings->enable) {
       logger::info("Flask type {} disabled", static_cast<int>(type));
       return true;
     }
     
-    if (is_in_inventory_mode(ctx.actor, type) && try_potion_has_keyword(ctx.potion, settings->inventory_keyword)) {
+    if (is_in_inventory_mode(ctx.actor, snapshot.get(), type) &&
+        try_potion_has_keyword(ctx.potion, snapshot.get(), get_type_masks(snapshot.get(), type).inventory)) {
       logger::info("Flask in_inventory_mode consumed ", ctx.potion->GetName());
       return true;
     }
@@ -792,20 +1355,32 @@ namespace features::true_flasks
     if (is_player && !settings->player) return true;
     if (!is_player && !settings->npc) return true;
 
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(ctx.actor->GetFormID());
+    auto& actor_data = get_actor_data(ctx.actor, snapshot.get());
+    const auto anti_spam_duration = actor_data.get_anti_spam_duration(static_cast<int>(type));
 
-    if (settings->anti_spam && actor_data.anti_spam_durations[static_cast<int>(type)] > 0.f) {
+    if (settings->anti_spam && anti_spam_duration && *anti_spam_duration > 0.f) {
       logger::info("Anti-spam blocked drink for actor {:08X}", ctx.actor->GetFormID());
+      if (api::mod_api::has_flask_event_subscribers()) {
+        queue_flask_event(ctx.actor, snapshot.get(), actor_data, TrueFlasksAPI::FlaskEventType::DrinkBlocked, type,
+                          calculate_max_slots(ctx.actor, snapshot.get(), *settings, type),
+                          TrueFlasksAPI::DrinkBlockedReason::AntiSpam);
+      }
       return false;
     }
     
-    if (consume_flask_slot(type, ctx.actor, 1)) {
-      if (settings->anti_spam) {
-        actor_data.anti_spam_durations[static_cast<int>(type)] = settings->anti_spam_delay;
+    if (consume_flask_slot(type, ctx.actor, snapshot.get(), 1)) {
+      if (settings->anti_spam && anti_spam_duration) {
+        *anti_spam_duration = settings->anti_spam_delay;
       }
       return true;
     }
 
+    if (api::mod_api::has_flask_event_subscribers()) {
+      queue_flask_event(ctx.actor, snapshot.get(), actor_data, TrueFlasksAPI::FlaskEventType::DrinkBlocked, type,
+                        calculate_max_slots(ctx.actor, snapshot.get(), *settings, type),
+                        TrueFlasksAPI::DrinkBlockedReason::Empty);
+    }
+
     if (is_player) {
       if (!settings->notify.empty()) {
         RE::SendHUDMessage::ShowHUDMessage(settings->notify.c_str());
@@ -815,54 +1390,84 @@ namespace features::true_flasks
         // RE::PlaySound(core::utility::get_editor_id(settings->fail_audio_form));
         core::utility::game::try_play_sound_at(ctx.actor, settings->fail_audio_form);
       }
-      // Trigger glow in UI via flag
-      actor_data.failed_drink_types[static_cast<int>(type)] = true;
+      // Trigger glow in UI via flag, the widget only shows the built-in types
+      if (static_cast<int>(type) < kFlaskTypeCount) {
+        actor_data.failed_drink_types[static_cast<int>(type)] = true;
+      }
       logger::info("Flask usage failed (no slots): type {}", static_cast<int>(type));
     }
 
     return false;
   }
 
+  // Records the actor's frame tick in the actor table, applied with everyone else's by flush_actor_ticks().
   export void update(const core::hooks_ctx::on_actor_update& ctx)
   {
-    
-    const auto config = config::config_manager::get_singleton();
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(ctx.actor->GetFormID());
-
-    auto d_data = core::actors_cache::cache_data::actor_data::delta_data{};
-    d_data.delta = ctx.delta;
-
-    auto calc_delta = [&](const flask_type type) {
-      const auto settings = get_settings(config, type);
-      const auto mult = calculate_regen_mult(ctx.actor, *settings);
-      return ctx.delta * mult;
-    };
+    const auto cache = core::actors_cache::cache_data::get_singleton();
+    const auto form_id = ctx.actor->GetFormID();
+    // Taken once per update; everything below reads this snapshot.
+    const auto snapshot = config::current_snapshot();
+    // Only actors that can use flasks or already have slots recharging (API consumes) are ticked.
+    if (!is_flask_user(ctx.actor, snapshot.get()) && !cache->contains(form_id)) {
+      return;
+    }
 
-    d_data.delta_health = calc_delta(flask_type::Health);
-    d_data.delta_stamina = calc_delta(flask_type::Stamina);
-    d_data.delta_magick = calc_delta(flask_type::Magick);
-    d_data.delta_other = calc_delta(flask_type::Other);
+    std::lock_guard<std::mutex> lock(g_actor_ticks.mutex);
+    auto& actor_data = cache->get_or_add(form_id);
+    sync_game_time(ctx.actor, snapshot.get(), actor_data, ctx.delta);
 
-    d_data.parallel_health = config->flasks_health.enable_parallel_cooldown;
-    d_data.parallel_stamina = config->flasks_stamina.enable_parallel_cooldown;
-    d_data.parallel_magick = config->flasks_magick.enable_parallel_cooldown;
-    d_data.parallel_other = config->flasks_other.enable_parallel_cooldown;
+    const auto delta_data =
+      make_delta_data(ctx.actor, snapshot.get(), ctx.delta, api::mod_api::has_flask_event_subscribers());
+    cache->mark_seen(form_id, delta_data);
+  }
 
+  // Main thread, once per frame: applies the queued ticks and reports slots that became ready.
+  export void flush_actor_ticks()
+  {
+    // Copied out rather than swapped, so the shared list keeps its capacity and the copy lives in the frame arena.
+    std::pmr::vector<std::pair<RE::FormID, std::uint64_t>> ready(
+      core::frame_arena::frame_arena::get_singleton()->resource());
+    const auto snapshot = config::current_snapshot();
+    {
+      std::lock_guard<std::mutex> lock(g_actor_ticks.mutex);
+      apply_actor_ticks(snapshot.get());
+      ready.assign(g_actor_ticks.ready.begin(), g_actor_ticks.ready.end());
+      g_actor_ticks.ready.clear();
+    }
+
+    const auto type_count = get_flask_type_count(&snapshot->values);
+    for (const auto& [form_id, mask] : ready) {
+      const auto actor = RE::TESForm::LookupByID<RE::Actor>(form_id);
+      if (!actor) {
+        continue;
+      }
 
-    actor_data.update(d_data);
+      auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(form_id);
+      for (const int index : std::views::iota(0, type_count)) {
+        if ((mask >> index & 1) == 0) {
+          continue;
+        }
+        const auto type = static_cast<flask_type>(index);
+        if (const auto settings = get_settings(&snapshot->values, type)) {
+          queue_flask_event(actor, snapshot.get(), actor_data, TrueFlasksAPI::FlaskEventType::SlotReady, type,
+                            calculate_max_slots(actor, snapshot.get(), *settings, type));
+        }
+      }
+    }
   }
   
   export void update_1s(const core::hooks_ctx::on_actor_update& ctx)
   {
     
-    const auto config = config::config_manager::get_singleton();
+    const auto snapshot = config::current_snapshot();
     auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(ctx.actor->GetFormID());
 
-    for (auto type : kFlaskTypes) {
-      if (is_in_inventory_mode_deposit(ctx.actor, type)) {
-        const auto settings = get_settings(config, type);
+    for (const int index : std::views::iota(0, get_flask_type_count(&snapshot->values))) {
+      const auto type = static_cast<flask_type>(index);
+      if (is_in_inventory_mode_deposit(ctx.actor, snapshot.get(), type)) {
+        const auto settings = get_settings(&snapshot->values, type);
         if (settings) {
-          try_inventory_deposit(ctx.actor, actor_data, *settings, type);
+          try_inventory_deposit(ctx.actor, snapshot.get(), actor_data, *settings, type);
         }
       }
     }
@@ -879,14 +1484,24 @@ namespace features::true_flasks
       if (actor_data.failed_drink_types[i]) {
         
         const auto type = static_cast<TrueFlasksAPI::FlaskType>(i);
-        for (const auto& flask_glow_call : *flask_glow_callbacks | std::views::values) {
-          flask_glow_call(type);
-        }
+        flask_glow_callbacks->invoke_all(type);
         
         actor_data.failed_drink_types[i] = false;
       }
     }
-    
+
+    // Cap changes have no single trigger (effects, perks, inventory), so the player's caps are polled here.
+    // Other actors report them with their next event.
+    if (api::mod_api::has_flask_event_subscribers()) {
+      const auto snapshot = config::current_snapshot();
+      for (const int index : std::views::iota(0, get_flask_type_count(&snapshot->values))) {
+        const auto type = static_cast<flask_type>(index);
+        if (const auto settings = get_settings(&snapshot->values, type)) {
+          queue_flask_event(ctx.actor, snapshot.get(), actor_data, TrueFlasksAPI::FlaskEventType::CapChanged, type,
+                            calculate_max_slots(ctx.actor, snapshot.get(), *settings, type));
+        }
+      }
+    }
   }
 
   export void remove_item(core::hooks_ctx::on_actor_remove_item& ctx)
@@ -898,15 +1513,17 @@ namespace features::true_flasks
     const auto potion = ctx.item->As<RE::AlchemyItem>();
     if (!potion) return;
 
-    const auto config = config::config_manager::get_singleton();
+    const auto snapshot = config::current_snapshot();
+    const auto config = &snapshot->values;
 
     // Check for NoRemoveKeyword
-    if (config->main.no_remove_keyword && core::utility::try_form_has_keyword(potion, config->main.no_remove_keyword)) {
-      const auto type_opt = identify_flask_type(potion, config);
+    if ((get_potion_masks(potion, snapshot.get()).own & snapshot->no_remove).any()) {
+      const auto type_opt = classify_potion(potion, snapshot.get());
       if (!type_opt.has_value()) return;
 
       const auto type = type_opt.value();
       const auto settings = get_settings(config, type);
+      if (!settings) return;
 
       const auto is_player = core::utility::is_player(ctx.actor);
       logger::info(
@@ -924,16 +1541,144 @@ namespace features::true_flasks
     }
   }
   
+  // Hotkeys compiled from the settings. Sorted by key so a key without a binding is rejected with one
+  // binary search; bindings sharing a key keep the type order, Health first.
+  struct hotkey_binding
+  {
+    std::uint32_t key;
+    std::uint32_t modifier;
+    flask_type type;
+  };
+
+  struct hotkey_dispatch_table
+  {
+    std::uint64_t version{0};
+    std::vector<hotkey_binding> keyboard;
+    std::vector<hotkey_binding> gamepad;
+  };
+
+  bool is_valid_hotkey(const std::uint32_t key)
+  {
+    return key != 0 && key != static_cast<std::uint32_t>(-1);
+  }
+
+  // Input thread only, rebuilt when a new settings snapshot is published.
+  const hotkey_dispatch_table& get_hotkey_dispatch_table(const config::settings_snapshot* snapshot)
+  {
+    static hotkey_dispatch_table table;
+    if (table.version == snapshot->version) {
+      return table;
+    }
+
+    table.version = snapshot->version;
+    table.keyboard.clear();
+    table.gamepad.clear();
+
+    const auto add_binding = [](std::vector<hotkey_binding>& bindings, const std::uint32_t key,
+                                const std::uint32_t modifier, const flask_type type) {
+      // A modifier set to an invalid key disables the binding, as it never counts as held.
+      if (is_valid_hotkey(key) && (modifier == 0 || is_valid_hotkey(modifier))) {
+        bindings.push_back({key, modifier, type});
+      }
+    };
+
+    const auto& config = snapshot->values;
+    for (const int index : std::views::iota(0, get_flask_type_count(&config))) {
+      const auto type = static_cast<flask_type>(index);
+      if (type == flask_type::Other) {
+        continue;
+      }
+      const auto& settings = *static_cast<const config::flask_settings*>(get_settings(&config, type));
+      if (!settings.enable || !settings.player || !settings.keyword) {
+        continue;
+      }
+      add_binding(table.keyboard, settings.hotkey, settings.hotkey_modifier, type);
+      add_binding(table.gamepad, settings.gamepad_hotkey, settings.gamepad_hotkey_modifier, type);
+    }
+
+    std::ranges::stable_sort(table.keyboard, {}, &hotkey_binding::key);
+    std::ranges::stable_sort(table.gamepad, {}, &hotkey_binding::key);
+    return table;
+  }
+
+  // Flask potion of each type in the player's inventory, so a hotkey drink does not build the inventory map.
+  // Misses are cached too. Any change to the player's container or the settings clears it.
+  struct flask_item_cache
+  {
+    std::uint64_t version{0};
+    std::array<RE::TESBoundObject*, kFlaskTypeCount + kFlaskCategoryMaxCount> items{};
+    std::array<bool, kFlaskTypeCount + kFlaskCategoryMaxCount> looked_up{};
+  };
+
+  std::atomic<bool> g_flask_items_dirty{true};
+
+  // Input thread only.
+  RE::TESBoundObject* get_cached_flask_item(RE::PlayerCharacter* player, const config::settings_snapshot* snapshot,
+                                            const flask_type type)
+  {
+    static flask_item_cache cache;
+    if (g_flask_items_dirty.exchange(false, std::memory_order_acq_rel) || cache.version != snapshot->version) {
+      cache.version = snapshot->version;
+      cache.looked_up.fill(false);
+    }
+
+    const auto index = static_cast<int>(type);
+    if (!cache.looked_up[index]) {
+      const auto settings = static_cast<const config::flask_settings*>(get_settings(&snapshot->values, type));
+      cache.items[index] =
+        core::utility::game::get_object_in_inventory_by_keyword(player, settings->keyword, RE::FormType::AlchemyItem);
+      cache.looked_up[index] = true;
+    }
+    return cache.items[index];
+  }
+
+  export void on_container_changed(const events::events_ctx::process_event_container_changed_ctx& ctx)
+  {
+    const auto player = RE::PlayerCharacter::GetSingleton();
+    if (!player) {
+      return;
+    }
+
+    const auto player_id = player->GetFormID();
+    if (ctx.container_event->oldContainer != player_id && ctx.container_event->newContainer != player_id) {
+      return;
+    }
+
+    g_flask_items_dirty.store(true, std::memory_order_release);
+    g_potion_counts_dirty.store(true, std::memory_order_release);
+    // An inventory change often comes with changed effects: gear dropped, a potion drunk from a menu.
+    begin_frame();
+    if (const auto potion = RE::TESForm::LookupByID<RE::AlchemyItem>(ctx.container_event->baseObj)) {
+      update_ranked_potion(potion, config::current_snapshot().get(), player->GetItemCount(potion));
+    }
+  }
+
+  // Inventories are replaced wholesale by a load, without container change events.
+  export void on_game_loaded()
+  {
+    g_flask_items_dirty.store(true, std::memory_order_release);
+    g_potion_counts_dirty.store(true, std::memory_order_release);
+    reset_potion_rankings();
+  }
+
   export auto on_input_event(const events::events_ctx::process_event_input_ctx& ctx) 
   {
     if (!ctx.button_event || !ctx.button_event->IsDown()) {
       return;
     }
 
+    const auto snapshot = config::current_snapshot();
+    const auto is_gamepad = ctx.device == RE::INPUT_DEVICE::kGamepad;
+    const auto& table = get_hotkey_dispatch_table(snapshot.get());
+    const auto [first, last] = std::ranges::equal_range(is_gamepad ? table.gamepad : table.keyboard, ctx.key, {},
+                                                        &hotkey_binding::key);
+    if (first == last) {
+      return;
+    }
+
     auto player = RE::PlayerCharacter::GetSingleton();
     auto equip_manager = RE::ActorEquipManager::GetSingleton();
-    auto config = config::config_manager::get_singleton();
-    if (!player || !equip_manager || !config) {
+    if (!player || !equip_manager) {
       return;
     }
 
@@ -957,101 +1702,65 @@ namespace features::true_flasks
       }
     };
 
-    const auto is_valid_hotkey = [](const std::uint32_t key) {
-      return key != 0 && key != static_cast<std::uint32_t>(-1);
-    };
-
-    const auto matches_binding = [&](const config::flask_settings& settings) {
-      if (ctx.device == RE::INPUT_DEVICE::kGamepad) {
-        if (!is_valid_hotkey(settings.gamepad_hotkey)) {
-          return false;
-        }
-
-        if (settings.gamepad_hotkey_modifier == 0) {
-          return ctx.key == settings.gamepad_hotkey;
-        }
-
-        if (!is_valid_hotkey(settings.gamepad_hotkey_modifier)) {
-          return false;
-        }
-
-        // ctx.key is already translated to SKSE gamepad keycodes, but IsPressed
-        // expects native device masks, so convert the modifier back before the check
-        auto input_device = get_input_device(ctx.device);
-        return input_device && ctx.key == settings.gamepad_hotkey &&
-               input_device->IsPressed(SKSE::InputMap::GamepadKeycodeToMask(settings.gamepad_hotkey_modifier));
-      }
-
-      if (!is_valid_hotkey(settings.hotkey)) {
-        return false;
-      }
-
-      if (settings.hotkey_modifier == 0) {
-        return ctx.key == settings.hotkey;
+    const auto is_modifier_held = [&](const std::uint32_t modifier) {
+      if (modifier == 0) {
+        return true;
       }
 
-      if (!is_valid_hotkey(settings.hotkey_modifier)) {
+      auto* input_device = get_input_device(ctx.device);
+      if (!input_device) {
         return false;
       }
 
-      auto* input_device = get_input_device(ctx.device);
-      return input_device && ctx.key == settings.hotkey &&
-             input_device->IsPressed(settings.hotkey_modifier);
+      // ctx.key is already translated to SKSE gamepad keycodes, but IsPressed
+      // expects native device masks, so convert the modifier back before the check
+      return is_gamepad ? input_device->IsPressed(SKSE::InputMap::GamepadKeycodeToMask(modifier))
+                        : input_device->IsPressed(modifier);
     };
 
-    const auto try_drink = [&](const config::flask_settings& settings) {
-      if (!matches_binding(settings) || !settings.enable || !settings.player || !settings.keyword) {
-        return false;
+    for (const auto& binding : std::ranges::subrange(first, last)) {
+      if (!is_modifier_held(binding.modifier)) {
+        continue;
       }
 
-      auto potion = core::utility::game::get_object_in_inventory_by_keyword(
-        player, settings.keyword, RE::FormType::AlchemyItem);
-      if (!potion) {
-        return false;
+      if (const auto potion = get_cached_flask_item(player, snapshot.get(), binding.type)) {
+        equip_manager->EquipObject(player, potion);
+        return;
       }
-
-      equip_manager->EquipObject(player, potion);
-      return true;
-    };
-
-    if (try_drink(config->flasks_health)) {
-      return;
     }
-
-    if (try_drink(config->flasks_stamina)) {
-      return;
-    }
-
-    try_drink(config->flasks_magick);
   }
 
   // API Functions
 
+  int get_max_slots(RE::Actor* actor, const config::settings_snapshot* snapshot, const flask_type type)
+  {
+    const auto settings = get_settings(&snapshot->values, type);
+    if (!settings) return 0;
+    return calculate_max_slots(actor, snapshot, *settings, type);
+  }
+
   export auto api_get_max_slots(RE::Actor* actor, const flask_type type) -> int
   {
     if (!actor) return 0;
-    const auto config = config::config_manager::get_singleton();
-    const auto settings = get_settings(config, type);
-    if (!settings) return 0;
-    return calculate_max_slots(actor, *settings, type);
+    return get_max_slots(actor, config::current_snapshot().get(), type);
   }
 
   export auto api_get_current_slots(RE::Actor* actor, const flask_type type) -> int
   {
     if (!actor) return 0;
 
-    const auto max_slots = api_get_max_slots(actor, type);
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
-    auto flasks = get_flasks_array(actor_data, type);
+    const auto snapshot = config::current_snapshot();
+    const auto max_slots = get_max_slots(actor, snapshot.get(), type);
+    actor_data_scratch scratch;
+    const auto flasks = read_flasks_array(find_actor_data(actor, scratch), snapshot.get(), type);
 
     if (!flasks) return 0;
 
     int available = 0;
     const int limit = get_slot_limit(max_slots);
     
-    auto settings = get_settings(config::config_manager::get_singleton(), type);
-    if (is_in_inventory_mod_use(actor, type)) {
-      auto potion_count = get_potions_count(actor, *settings, type);
+    if (is_in_inventory_mod_use(actor, snapshot.get(), type)) {
+      auto potion_count = get_potions_count(actor, snapshot.get(), type);
       if (potion_count > limit) {
         return limit;
       }
@@ -1070,13 +1779,14 @@ namespace features::true_flasks
   {
     if (!actor) return 0.f;
     
-    if (is_in_inventory_mod_use(actor, type)) {
+    const auto snapshot = config::current_snapshot();
+    if (is_in_inventory_mod_use(actor, snapshot.get(), type)) {
       return 0.f;
     }
 
-    const auto max_slots = api_get_max_slots(actor, type);
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
-    auto flasks = get_flasks_array(actor_data, type);
+    const auto max_slots = get_max_slots(actor, snapshot.get(), type);
+    actor_data_scratch scratch;
+    const auto flasks = read_flasks_array(find_actor_data(actor, scratch), snapshot.get(), type);
 
     if (!flasks) return 0.f;
 
@@ -1097,20 +1807,21 @@ namespace features::true_flasks
   {
     if (!actor) return false;
 
-    const auto config = config::config_manager::get_singleton();
-    const auto settings = get_settings(config, type);
+    const auto snapshot = config::current_snapshot();
+    const auto settings = get_settings(&snapshot->values, type);
     if (!settings) return false;
 
-    return calculate_regen_mult_raw(actor, *settings) > 0.0f;
+    return calculate_regen_mult_raw(actor, snapshot.get(), *settings, type) > 0.0f;
   }
 
   export auto api_modify_cooldown(RE::Actor* actor, const flask_type type, const float amount,
                                   const bool all_slots) -> void
   {
-    if (!actor) return;
+    const auto snapshot = config::current_snapshot();
+    if (!actor || !is_valid_flask_type(snapshot.get(), type)) return;
 
-    const auto max_slots = api_get_max_slots(actor, type);
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
+    const auto max_slots = get_max_slots(actor, snapshot.get(), type);
+    auto& actor_data = get_actor_data(actor, snapshot.get());
     auto flasks = get_flasks_array(actor_data, type);
 
     if (!flasks) return;
@@ -1157,23 +1868,24 @@ namespace features::true_flasks
   export auto api_get_regen_mult(RE::Actor* actor, const flask_type type) -> float
   {
     if (!actor) return 0.f;
-    const auto config = config::config_manager::get_singleton();
-    const auto settings = get_settings(config, type);
+    const auto snapshot = config::current_snapshot();
+    const auto settings = get_settings(&snapshot->values, type);
     if (!settings) return 0.f;
-    return calculate_regen_mult_raw(actor, *settings);
+    return calculate_regen_mult_raw(actor, snapshot.get(), *settings, type);
   }
 
   export auto api_get_cooldown_pct(RE::Actor* actor, const flask_type type) -> float
   {
     if (!actor) return 1.0f;
     
-    if (is_in_inventory_mod_use(actor, type)) {
+    const auto snapshot = config::current_snapshot();
+    if (is_in_inventory_mod_use(actor, snapshot.get(), type)) {
       return 1.f;
     }
 
-    const auto max_slots = api_get_max_slots(actor, type);
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
-    auto flasks = get_flasks_array(actor_data, type);
+    const auto max_slots = get_max_slots(actor, snapshot.get(), type);
+    actor_data_scratch scratch;
+    const auto flasks = read_flasks_array(find_actor_data(actor, scratch), snapshot.get(), type);
 
     if (!flasks) return 1.0f;
 
@@ -1198,10 +1910,90 @@ namespace features::true_flasks
     return 1.0f;
   }
 
+  // Same values as the individual api_* getters, but max slots and slots are evaluated once.
+  TrueFlasksAPI::FlaskTypeSnapshot make_type_snapshot(RE::Actor* actor,
+                                                      const config::settings_snapshot* settings_snapshot,
+                                                      const core::actors_cache::cache_data::actor_data* actor_data,
+                                                      const config::flask_settings_base& settings,
+                                                      const flask_type type)
+  {
+    auto snapshot = TrueFlasksAPI::FlaskTypeSnapshot{0, 0, 0.f, 1.f, 0.f};
+    snapshot.regen_mult = calculate_regen_mult_raw(actor, settings_snapshot, settings, type);
+
+    if (is_in_inventory_mod_use(actor, settings_snapshot, type)) {
+      const auto potion_count = get_potions_count(actor, settings_snapshot, type);
+      snapshot.max_slots = potion_count;
+      snapshot.current_slots = get_slot_limit(potion_count);
+      return snapshot;
+    }
+
+    snapshot.max_slots = calculate_max_slots(actor, settings_snapshot, settings, type);
+    const auto flasks = read_flasks_array(actor_data, settings_snapshot, type);
+    if (!flasks) {
+      return snapshot;
+    }
+
+    int nearest_idx = -1;
+    for (const int i : std::views::iota(0, get_slot_limit(snapshot.max_slots))) {
+      if (flasks[i].cooldown_current <= 0.f) {
+        snapshot.current_slots++;
+      }
+      else if (nearest_idx < 0 || flasks[i].cooldown_current < flasks[nearest_idx].cooldown_current) {
+        nearest_idx = i;
+      }
+    }
+
+    if (nearest_idx >= 0) {
+      snapshot.next_cooldown = flasks[nearest_idx].cooldown_current;
+      if (flasks[nearest_idx].cooldown_start > 0.f) {
+        snapshot.cooldown_pct = 1.0f - (flasks[nearest_idx].cooldown_current / flasks[nearest_idx].cooldown_start);
+      }
+    }
+
+    return snapshot;
+  }
+
+  void fill_flask_snapshot(RE::Actor* actor, const core::actors_cache::cache_data::actor_data* actor_data,
+                           const config::settings_snapshot* snapshot, TrueFlasksAPI::FlaskSnapshot& out)
+  {
+    for (const auto type : kFlaskTypes) {
+      const auto settings = get_settings(&snapshot->values, type);
+      if (!settings) continue;
+      out.types[static_cast<int>(type)] = make_type_snapshot(actor, snapshot, actor_data, *settings, type);
+    }
+  }
+
+  export auto api_get_flask_snapshot(RE::Actor* actor, TrueFlasksAPI::FlaskSnapshot& out) -> bool
+  {
+    if (!actor) return false;
+
+    const auto snapshot = config::current_snapshot();
+    actor_data_scratch scratch;
+    fill_flask_snapshot(actor, find_actor_data(actor, scratch), snapshot.get(), out);
+    return true;
+  }
+
+  // Fills out[i] for actors[i] under a single cache lock. Null actors get a zeroed snapshot.
+  export auto api_get_flask_snapshots(const std::span<RE::Actor* const> actors,
+                                      const std::span<TrueFlasksAPI::FlaskSnapshot> out) -> std::size_t
+  {
+    const auto count = (std::min)(actors.size(), out.size());
+    std::ranges::fill(out.first(count), TrueFlasksAPI::FlaskSnapshot{});
+
+    const auto snapshot = config::current_snapshot();
+    std::size_t filled = 0;
+    core::actors_cache::cache_data::get_singleton()->for_each_actor(
+      actors.first(count), [&](const std::size_t index, RE::Actor* actor, const auto* actor_data) {
+        fill_flask_snapshot(actor, actor_data, snapshot.get(), out[index]);
+        ++filled;
+      });
+
+    return filled;
+  }
+
   export auto api_get_flask_info(RE::AlchemyItem* potion) -> std::pair<int, bool>
   {
-    const auto config = config::config_manager::get_singleton();
-    const auto type_opt = identify_flask_type(potion, config);
+    const auto type_opt = classify_potion(potion, config::current_snapshot().get());
 
     if (!type_opt.has_value()) {
       return {-1, false};
@@ -1212,26 +2004,31 @@ namespace features::true_flasks
   
   export auto api_play_flask_glow(RE::Actor* actor, const flask_type type) -> void
   {
-    if (!actor || !is_valid_flask_type(type)) return;
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(actor->GetFormID());
+    // Only the built-in types have a glow flag, the widget does not show categories.
+    const auto snapshot = config::current_snapshot();
+    if (!actor || !is_valid_flask_type(snapshot.get(), type) || static_cast<int>(type) >= kFlaskTypeCount) return;
+    auto& actor_data = get_actor_data(actor, snapshot.get());
     actor_data.failed_drink_types[static_cast<int>(type)] = true;
   }
   
   export auto api_consume_flask_slot(RE::Actor* actor, const flask_type type, const int count) -> bool
   {
-    if (!actor || !is_valid_flask_type(type)) return false;
-    return consume_flask_slot(type, actor, std::abs(count));
+    const auto snapshot = config::current_snapshot();
+    if (!actor || !is_valid_flask_type(snapshot.get(), type)) return false;
+    return consume_flask_slot(type, actor, snapshot.get(), std::abs(count));
   }
   
   export auto api_restore_flask_slot(RE::Actor* actor, const flask_type type, const int count) -> bool
   {
-    if (!actor || !is_valid_flask_type(type)) return false;
-    return restore_flask_slot(type, actor, std::abs(count));
+    const auto snapshot = config::current_snapshot();
+    if (!actor || !is_valid_flask_type(snapshot.get(), type)) return false;
+    return restore_flask_slot(type, actor, snapshot.get(), std::abs(count));
   }
 
   export auto api_get_flask_settings(const flask_type type) -> std::optional<TrueFlasksAPI::FlaskSettings>
   {
-    const auto config = config::config_manager::get_singleton();
+    const auto snapshot = config::current_snapshot();
+    const auto config = &snapshot->values;
     const auto settings = get_settings(config, type);
 
     if (!settings) return std::nullopt;
@@ -1271,7 +2068,8 @@ namespace features::true_flasks
         break;
       case flask_type::Magick: out.keyword = config->flasks_magick.keyword;
         break;
-      default: break;
+      default: out.keyword = static_cast<const config::flask_category_settings*>(settings)->keyword;
+        break;
       }
     }
 
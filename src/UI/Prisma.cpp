@@ -11,7 +11,10 @@ import TrueFlasks.Core.HooksCtx;
 import TrueFlasks.Config;
 import TrueFlasks.Features.TrueFlasks;
 import TrueFlasks.Core.ActorsCache;
+import TrueFlasks.Core.MenuTracker;
 import TrueFlasks.Events.EventsCtx;
+import TrueFlasks.Core.Telemetry;
+import TrueFlasks.Core.FrameArena;
 
 namespace ui::prisma
 {
@@ -54,6 +57,9 @@ namespace ui::prisma
     bool in_combat;
   };
 
+  // Room for one serialized flask_update_data, whose longest form is about 190 characters.
+  constexpr std::size_t kFlaskUpdateJsonReserve = 256;
+
   bool view_init = false;
   bool first_init = true;
 
@@ -110,6 +116,17 @@ namespace ui::prisma
     return std::nullopt;
   }
 
+  // Every call into the widget goes through here so telemetry sees the calls and the bytes sent. argument must be
+  // null-terminated, as any std::string or std::pmr::string is.
+  void interop_call(PRISMA_UI_API::IVPrismaUI1* api, const PrismaView view, const char* function,
+                    const std::string_view argument)
+  {
+    const auto telemetry = core::telemetry::telemetry::get_singleton();
+    telemetry->add(core::telemetry::metric::widget_interop_calls);
+    telemetry->add(core::telemetry::metric::widget_bytes_sent, argument.size());
+    api->InteropCall(view, function, argument.data());
+  }
+
   void send_font()
   {
     auto api = core::mods_api_repository::get_prisma_ui();
@@ -123,7 +140,7 @@ namespace ui::prisma
       return;
     }
 
-    api->InteropCall(view, "setWidgetFont", font_filename->c_str());
+    interop_call(api, view, "setWidgetFont", *font_filename);
   }
 
   export void send_settings(const bool init = false)
@@ -132,7 +149,7 @@ namespace ui::prisma
     auto& view = get_view_ref();
     if (!is_view_usable(api, view)) return;
 
-    const auto config = config::config_manager::get_singleton();
+    const auto config = config::current();
     const auto& cfg = config->prisma_widget;
 
     global_widget_settings settings;
@@ -170,11 +187,11 @@ namespace ui::prisma
         first_init = false;
         api->Hide(view);
       }
-      api->InteropCall(view, "setWidgetSettingsInit", json.c_str());
+      interop_call(api, view, "setWidgetSettingsInit", json);
       return;
     }
 
-    api->InteropCall(view, "setWidgetSettings", json.c_str());
+    interop_call(api, view, "setWidgetSettings", json);
   }
 
   void on_dom_ready(PrismaView)
@@ -213,14 +230,14 @@ namespace ui::prisma
 
 
   void update_flask(PRISMA_UI_API::IVPrismaUI1* api, PrismaView view, RE::Actor* actor, TrueFlasksAPI::FlaskType type,
-                    int type_idx, bool force_glow = false)
+                    int type_idx, const TrueFlasksAPI::FlaskTypeSnapshot& snapshot,
+                    const config::prisma_widget_settings& prisma_settings, bool force_glow = false)
   {
-    // Gather current flask state.
-    float pct = features::true_flasks::api_get_cooldown_pct(actor, type);
-    int count = features::true_flasks::api_get_current_slots(actor, type);
-    int max_slots = features::true_flasks::api_get_max_slots(actor, type);
+    // Current flask state comes from the snapshot gathered once for all types.
+    float pct = snapshot.cooldown_pct;
+    int count = snapshot.current_slots;
+    int max_slots = snapshot.max_slots;
 
-    const auto& prisma_settings = config::config_manager::get_singleton()->prisma_widget;
     const config::prisma_flask_widget_settings* flask_setting = &prisma_settings.health;
     switch (type) {
     case TrueFlasksAPI::FlaskType::Health: {
@@ -241,25 +258,29 @@ namespace ui::prisma
     }
     }
 
-    const bool can_regenerate = features::true_flasks::api_can_regenerate(actor, type);
+    const bool can_regenerate = snapshot.regen_mult > 0.0f;
 
     flask_update_data data{type_idx, pct, count, max_slots, can_regenerate, force_glow,
                            flask_setting->fill_animation, flask_setting->fill_animation_only_zero,
                            actor->IsInCombat()};
 
-    std::string json;
-    // Serialize with glaze to preserve the existing payload shape.
+    // Serialize with glaze to preserve the existing payload shape. The payload is built in the frame arena and
+    // handed to the widget before the frame ends; a growth past the reserve also stays in the arena.
+    std::pmr::string json(core::frame_arena::frame_arena::get_singleton()->resource());
+    json.reserve(kFlaskUpdateJsonReserve);
     if (const auto ec = glz::write_json(data, json)) {
       return;
     }
 
     // InteropCall is the hot path for frequent UI updates.
-    api->InteropCall(view, "updateFlaskData", json.c_str());
+    interop_call(api, view, "updateFlaskData", json);
   }
 
   export void update(const core::hooks_ctx::on_actor_update& ctx)
   {
-    if (!config::config_manager::get_singleton()->prisma_widget.enable || !view_init) {
+    // Taken once for the whole update, the per-type calls below read the same settings.
+    const auto config = config::current();
+    if (!config->prisma_widget.enable || !view_init) {
       return;
     }
 
@@ -269,17 +290,24 @@ namespace ui::prisma
     auto& view = get_view_ref();
     if (!is_view_usable(api, view)) return;
 
-    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_or_add(ctx.actor->GetFormID());
+    auto& actor_data = core::actors_cache::cache_data::get_singleton()->get_player();
 
     bool glow_health = actor_data.failed_drink_types[static_cast<int>(TrueFlasksAPI::FlaskType::Health)];
     bool glow_stamina = actor_data.failed_drink_types[static_cast<int>(TrueFlasksAPI::FlaskType::Stamina)];;
     bool glow_magick = actor_data.failed_drink_types[static_cast<int>(TrueFlasksAPI::FlaskType::Magick)];;
     bool glow_other = actor_data.failed_drink_types[static_cast<int>(TrueFlasksAPI::FlaskType::Other)];;
 
-    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Health, 0, glow_health);
-    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Stamina, 1, glow_stamina);
-    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Magick, 2, glow_magick);
-    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Other, 3, glow_other);
+    TrueFlasksAPI::FlaskSnapshot snapshot{};
+    if (!features::true_flasks::api_get_flask_snapshot(ctx.actor, snapshot)) return;
+
+    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Health, 0, snapshot.types[0], config->prisma_widget,
+                 glow_health);
+    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Stamina, 1, snapshot.types[1], config->prisma_widget,
+                 glow_stamina);
+    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Magick, 2, snapshot.types[2], config->prisma_widget,
+                 glow_magick);
+    update_flask(api, view, ctx.actor, TrueFlasksAPI::FlaskType::Other, 3, snapshot.types[3], config->prisma_widget,
+                 glow_other);
 
     if (api->IsHidden(view)) {
       api->Show(view);
@@ -308,9 +336,20 @@ namespace ui::prisma
     initialize();
   }
 
+  // Pushes reloaded settings to the widget, recreating the view if it was switched on or off.
+  export void on_config_reloaded(const bool previous_enable)
+  {
+    const auto enable = config::current()->prisma_widget.enable;
+    if (previous_enable != enable) {
+      update_enable(enable);
+    }
+
+    send_settings();
+  }
+
   export void on_menu_event(const events::events_ctx::process_event_menu_ctx& ctx)
   {
-    if (!config::config_manager::get_singleton()->prisma_widget.enable) {
+    if (!config::current()->prisma_widget.enable) {
       return;
     }
 
@@ -328,33 +367,11 @@ namespace ui::prisma
     }
     
 
-    if (auto ui = RE::UI::GetSingleton()) {
-      bool isLoadingMenu = ui->IsMenuOpen(RE::LoadingMenu::MENU_NAME);
-      bool shouldShowWidget = !(
-        ui->IsMenuOpen(RE::InventoryMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::CraftingMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::BarterMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::TweenMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::GiftMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::ContainerMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::MagicMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::DialogueMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::StatsMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::MessageBoxMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::JournalMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::LockpickingMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::SleepWaitMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::RaceSexMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::MapMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::FaderMenu::MENU_NAME) ||
-        ui->IsMenuOpen(RE::CursorMenu::MENU_NAME)
-      );
-      if (shouldShowWidget && !isLoadingMenu) {
-        prisma->Invoke(view, "Show()");
-        return;
-      }
-
-      prisma->Invoke(view, "Hide()");
+    if (!core::menu_tracker::menu_tracker::get_singleton()->is_any_open(core::menu_tracker::menu_group::hide_widget)) {
+      prisma->Invoke(view, "Show()");
+      return;
     }
+
+    prisma->Invoke(view, "Hide()");
   }
 }
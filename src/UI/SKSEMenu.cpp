@@ -8,6 +8,11 @@ export module TrueFlasks.UI.SKSEMenu;
 
 import TrueFlasks.Config;
 import TrueFlasks.UI.Prisma;
+import TrueFlasks.Core.ActorsCache;
+import TrueFlasks.Core.FrameScheduler;
+import TrueFlasks.Core.FrameArena;
+import TrueFlasks.Core.AllocationProfiler;
+import TrueFlasks.Core.Telemetry;
 
 namespace ui::skse_menu
 {
@@ -226,6 +231,48 @@ namespace ui::skse_menu
     }
   }
 
+  struct widget_refresh_state
+  {
+    bool pending{false};
+    bool previous_enable{true};
+  };
+
+  widget_refresh_state g_widget_refresh{};
+  bool g_menu_was_open{false};
+
+  // Settings are pushed to the widget from on_frame, so edits in one frame cost a single push.
+  void request_widget_refresh(const bool previous_enable)
+  {
+    if (!g_widget_refresh.pending) {
+      g_widget_refresh.pending = true;
+      g_widget_refresh.previous_enable = previous_enable;
+    }
+  }
+
+  void request_widget_refresh()
+  {
+    request_widget_refresh(config::config_manager::get_singleton()->prisma_widget.enable);
+  }
+
+  // Runs once per rendered frame whether the menu is open or not.
+  void __stdcall on_frame()
+  {
+    // Menu edits of this frame become one settings snapshot.
+    config::config_manager::get_singleton()->publish_pending();
+
+    if (g_widget_refresh.pending) {
+      g_widget_refresh.pending = false;
+      prisma::on_config_reloaded(g_widget_refresh.previous_enable);
+    }
+
+    const auto config = config::config_manager::get_singleton();
+    const auto menu_open = SKSEMenuFramework::IsAnyBlockingWindowOpened();
+    if (g_menu_was_open && !menu_open) {
+      config->flush_save();
+    }
+    g_menu_was_open = menu_open;
+  }
+
   void __stdcall render_config_actions()
   {
     if (ImGui::Button("Reload Configuration")) {
@@ -234,13 +281,15 @@ namespace ui::skse_menu
 
       config->load();
 
-      if (previous_prisma_enabled != config->prisma_widget.enable) {
-        prisma::update_enable(config->prisma_widget.enable);
-      }
-
-      prisma::send_settings();
+      prisma::on_config_reloaded(previous_prisma_enabled);
     }
     RenderTooltip("Reload TrueFlasksNG.ini from disk and refresh Prisma widget settings.");
+
+    auto* config = config::config_manager::get_singleton();
+    if (ImGui::Checkbox("Game Time Catch-Up", &config->main.game_time_catch_up)) {
+      config->mark_dirty();
+    }
+    RenderTooltip("If true, cooldowns also recharge for the game time that passed while waiting, sleeping or fast traveling.");
   }
 
   void render_inventory_settings(config::flask_settings& settings, bool& changed)
@@ -324,8 +373,8 @@ namespace ui::skse_menu
       RenderTooltip("Base cooldown duration in seconds for one slot.");
 
       if (changed) {
-        config::config_manager::get_singleton()->save();
-        prisma::send_settings();
+        config::config_manager::get_singleton()->mark_dirty();
+        request_widget_refresh();
       }
       ImGui::PopID();
     }
@@ -391,8 +440,8 @@ namespace ui::skse_menu
       RenderTooltip("If true, only items WITH the exclusive keyword are treated as 'Other'; otherwise only items WITHOUT it are.");
 
       if (changed) {
-        config->save();
-        prisma::send_settings();
+        config->mark_dirty();
+        request_widget_refresh();
       }
       ImGui::PopID();
     }
@@ -422,8 +471,8 @@ namespace ui::skse_menu
       RenderTooltip("If true, the fill animation plays ONLY when the flask is completely empty (0 charges).");
 
       if (changed) {
-        config::config_manager::get_singleton()->save();
-        prisma::send_settings();
+        config::config_manager::get_singleton()->mark_dirty();
+        request_widget_refresh();
       }
       ImGui::PopID();
       ImGui::TreePop();
@@ -470,11 +519,57 @@ namespace ui::skse_menu
     }
 
     if (changed) {
-      config->save();
-      if (last_enable_value != config->prisma_widget.enable) {
-        prisma::update_enable(config->prisma_widget.enable);
-      }
-      prisma::send_settings();
+      config->mark_dirty();
+      request_widget_refresh(last_enable_value);
+    }
+  }
+
+  void __stdcall render_diagnostics()
+  {
+    const auto stats = core::actors_cache::cache_data::get_singleton()->get_stats();
+    ImGui::Text("Tracked actors (hot): %zu", stats.hot);
+    RenderTooltip("Loaded actors that are updated every frame.");
+    ImGui::Text("Tracked actors (cold): %zu", stats.cold);
+    RenderTooltip("Unloaded actors whose recharging slots are kept until they return.");
+
+    const auto save_stats = config::config_manager::get_singleton()->get_save_stats();
+    ImGui::Text("Config writes: %llu of %llu requested (%llu avoided)", save_stats.written, save_stats.requested,
+                save_stats.requested > save_stats.written ? save_stats.requested - save_stats.written : 0ull);
+    RenderTooltip("Setting changes are saved once edits stop instead of on every change.");
+
+    ImGui::Separator();
+    ImGui::Text("Frame tasks");
+    for (const auto& task : core::frame_scheduler::frame_scheduler::get_singleton()->get_stats()) {
+      ImGui::Text("%s: %.3f ms (max %.3f), runs %llu, over budget %llu, deferred %llu", task.name.c_str(),
+                  task.last_cost_ms, task.max_cost_ms, task.runs, task.overruns, task.deferrals);
+    }
+    RenderTooltip("Periodic work spread over frames. Over budget counts runs slower than the task's budget.");
+
+    ImGui::Separator();
+    auto* config = config::config_manager::get_singleton();
+    if (ImGui::Checkbox("Allocation Profiling", &config->main.allocation_profiling)) {
+      config->mark_dirty();
+    }
+    RenderTooltip("Count the plugin's heap allocations per call site. Turning it on starts the counts over.");
+
+    if (ImGui::Checkbox("Telemetry Export", &config->main.telemetry_export)) {
+      config->mark_dirty();
+    }
+    RenderTooltip("On every save, on exit from a game (new game, load, Quit to the main menu), and when turned off, append this session's performance totals to TrueFlasksNG-telemetry.csv in the SKSE log directory. Turning it on starts a new session.");
+
+    const auto arena = core::frame_arena::frame_arena::get_singleton()->get_overflow_stats();
+    ImGui::Text("Frame arena overflow: %llu allocations, %llu bytes", arena.allocations, arena.bytes);
+    RenderTooltip("Per-frame scratch memory that did not fit into the frame arena and came from the heap.");
+
+    const auto allocations = core::allocation_profiler::get_stats();
+    if (!allocations.enabled) {
+      return;
+    }
+    ImGui::Text("Allocations last frame: %llu (peak %llu)", allocations.last_frame, allocations.peak_frame);
+    RenderTooltip("Heap allocations made by the per-frame work below during the last frame. Other is not included.");
+    for (const auto& site : allocations.sites) {
+      ImGui::Text("%.*s: %llu allocations, %llu bytes", static_cast<int>(site.name.size()), site.name.data(),
+                  site.allocations, site.bytes);
     }
   }
 
@@ -496,5 +591,10 @@ namespace ui::skse_menu
 
     static constexpr auto prisma_settings = "Prisma Settings";
     SKSEMenuFramework::AddSectionItem(prisma_settings, render_prisma_settings);
+
+    static constexpr auto diagnostics_title = "Diagnostics";
+    SKSEMenuFramework::AddSectionItem(diagnostics_title, render_diagnostics);
+
+    SKSEMenuFramework::AddHudElement(on_frame);
   }
 }
@@ -6,6 +6,74 @@ import TrueFlasks.Core.Hooks;
 import TrueFlasks.Core.ActorsCache;
 import TrueFlasks.Config;
 import TrueFlasks.Papyrus;
+import TrueFlasks.Features.TrueFlasks;
+import TrueFlasks.Core.AllocationProfiler;
+import TrueFlasks.Core.Telemetry;
+import TrueFlasks.Core.ThreadPool;
+
+// The plugin's own allocations go through these so the allocation profiler can charge them to a call site.
+// Aligned allocations keep the library versions and are not counted.
+auto operator new(const std::size_t size) -> void*
+{
+  core::allocation_profiler::record_allocation(size);
+  if (const auto pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+auto operator new[](const std::size_t size) -> void*
+{
+  return operator new(size);
+}
+
+auto operator delete(void* pointer) noexcept -> void
+{
+  std::free(pointer);
+}
+
+auto operator delete[](void* pointer) noexcept -> void
+{
+  std::free(pointer);
+}
+
+auto operator delete(void* pointer, std::size_t) noexcept -> void
+{
+  std::free(pointer);
+}
+
+auto operator delete[](void* pointer, std::size_t) noexcept -> void
+{
+  std::free(pointer);
+}
+
+auto skse_save_callback(SKSE::SerializationInterface* a_interface) -> void
+{
+  core::actors_cache::cache_data::skse_save_callback(a_interface);
+  papyrus::save(a_interface);
+  core::telemetry::telemetry::get_singleton()->request_export("save");
+}
+
+auto skse_revert_callback(SKSE::SerializationInterface* a_interface) -> void
+{
+  core::actors_cache::cache_data::skse_revert_callback(a_interface);
+  papyrus::revert(a_interface);
+}
+
+auto skse_load_callback(SKSE::SerializationInterface* a_interface) -> void
+{
+  skse_revert_callback(a_interface);
+
+  uint32_t type;
+  uint32_t version;
+  uint32_t length;
+  while (a_interface->GetNextRecordInfo(type, version, length)) {
+    if (core::actors_cache::cache_data::skse_load_record(a_interface, type)) {
+      continue;
+    }
+    papyrus::load_record(a_interface, type);
+  }
+}
 
 auto skse_message_handle(SKSE::MessagingInterface::Message* message) -> void
 {
@@ -24,12 +92,29 @@ auto skse_message_handle(SKSE::MessagingInterface::Message* message) -> void
     core::hooks::install_hooks();
     ui::prisma::initialize();
     events::register_events();
+    logger::info("Thread pool started with {} workers",
+                 core::thread_pool::thread_pool::get_singleton()->get_worker_count());
+    break;
+  }
+  case SKSE::MessagingInterface::kNewGame: {
+    // The game that was running ends here, its row is written before the new one starts.
+    core::telemetry::telemetry::get_singleton()->export_now("new_game");
+    features::true_flasks::on_game_loaded();
+    break;
+  }
+  case SKSE::MessagingInterface::kPostLoadGame: {
+    features::true_flasks::on_game_loaded();
+    break;
+  }
+  case SKSE::MessagingInterface::kSaveGame: {
+    // Menu edits still waiting for the idle period are written with the save.
+    config::config_manager::get_singleton()->flush_save();
+    break;
+  }
+  case SKSE::MessagingInterface::kPreLoadGame: {
+    core::telemetry::telemetry::get_singleton()->export_now("load");
     break;
   }
-  case SKSE::MessagingInterface::kNewGame:
-  case SKSE::MessagingInterface::kPreLoadGame:
-  case SKSE::MessagingInterface::kPostLoadGame:
-  case SKSE::MessagingInterface::kSaveGame:
   case SKSE::MessagingInterface::kDeleteGame:
   default:
     break;
@@ -62,8 +147,9 @@ SKSEPluginLoad(const SKSE::LoadInterface* skse)
   }
 
   serialization->SetUniqueID('TFNG');
-  serialization->SetSaveCallback(core::actors_cache::cache_data::skse_save_callback);
-  serialization->SetLoadCallback(core::actors_cache::cache_data::skse_load_callback);
+  serialization->SetSaveCallback(skse_save_callback);
+  serialization->SetRevertCallback(skse_revert_callback);
+  serialization->SetLoadCallback(skse_load_callback);
 
   logger::info("{} has finished loading.", plugin->GetName());
 
@@ -0,0 +1,125 @@
+// Batched actor ticks on 1 to N cores: the same table of actors is swept the way flush_actor_ticks() does it, one
+// 64-actor chunk per pool task, with pools of 0 up to hardware_concurrency() - 1 workers. Every run must leave the
+// table exactly as the single-threaded one does.
+
+import TrueFlasks.Core.FlaskTick;
+import TrueFlasks.Core.ThreadPool;
+
+namespace
+{
+  using namespace core::flask_tick;
+
+  struct bench_actor
+  {
+    flask_cooldown flasks[kBuiltinTypeCount][kSlotCount];
+    float anti_spam_durations[kBuiltinTypeCount]{};
+    std::vector<category_state> categories;
+  };
+
+  constexpr std::size_t kChunkSize = 64;
+  constexpr std::size_t kActorCount = 2048;
+  constexpr int kTypeCount = 16;
+  constexpr int kFrames = 100;
+  constexpr float kCooldown = 1000.f;
+
+  auto make_actors() -> std::vector<bench_actor>
+  {
+    std::vector<bench_actor> actors(kActorCount);
+    for (std::size_t a = 0; a < actors.size(); ++a) {
+      auto& actor = actors[a];
+      // Staggered cooldowns so the sequential types do not all pick the same slot.
+      for (auto& type : actor.flasks) {
+        for (int i = 0; i < kSlotCount; ++i) {
+          type[i] = flask_cooldown{kCooldown - static_cast<float>((a + i) % 97)};
+        }
+      }
+      actor.categories.resize(kTypeCount - kBuiltinTypeCount);
+      for (auto& category : actor.categories) {
+        std::ranges::fill(category.flasks, flask_cooldown{kCooldown});
+      }
+    }
+    return actors;
+  }
+
+  auto make_delta() -> delta_data
+  {
+    delta_data delta{};
+    delta.delta = 1.f / 60.f;
+    delta.category_count = kTypeCount - kBuiltinTypeCount;
+    for (int type = 0; type < kTypeCount; ++type) {
+      delta.deltas[type] = delta.delta;
+      delta.parallel[type] = type % 2 == 0;
+    }
+    return delta;
+  }
+
+  // Nanoseconds per actor tick.
+  auto run(core::thread_pool::thread_pool& pool, std::vector<bench_actor>& actors) -> double
+  {
+    const auto delta = make_delta();
+    const auto chunks = (actors.size() + kChunkSize - 1) / kChunkSize;
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < kFrames; ++frame) {
+      pool.parallel_for(chunks, 1, [&](const std::size_t begin, const std::size_t end) {
+        for (auto c = begin; c < end; ++c) {
+          const auto last = (std::min)((c + 1) * kChunkSize, actors.size());
+          for (auto a = c * kChunkSize; a < last; ++a) {
+            auto& actor = actors[a];
+            advance(actor.flasks, actor.anti_spam_durations, actor.categories, delta, false);
+          }
+        }
+      });
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / (static_cast<double>(actors.size()) * kFrames);
+  }
+
+  auto same_state(const std::vector<bench_actor>& a, const std::vector<bench_actor>& b) -> bool
+  {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      for (int type = 0; type < kBuiltinTypeCount; ++type) {
+        for (int slot = 0; slot < kSlotCount; ++slot) {
+          if (a[i].flasks[type][slot].cooldown_current != b[i].flasks[type][slot].cooldown_current) {
+            return false;
+          }
+        }
+      }
+      for (std::size_t c = 0; c < a[i].categories.size(); ++c) {
+        for (int slot = 0; slot < kSlotCount; ++slot) {
+          if (a[i].categories[c].flasks[slot].cooldown_current != b[i].categories[c].flasks[slot].cooldown_current) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+}
+
+int main()
+{
+  const auto hardware = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+  auto reference = make_actors();
+  core::thread_pool::thread_pool serial(0);
+  const auto serial_ns = run(serial, reference);
+  std::printf("%u core(s): %8.1f ns per actor tick\n", 1u, serial_ns);
+
+  for (unsigned cores = 2; cores <= hardware; ++cores) {
+    auto actors = make_actors();
+    core::thread_pool::thread_pool pool(cores - 1);
+    CHECK(pool.get_worker_count() == cores - 1);
+    const auto ns = run(pool, actors);
+    CHECK(same_state(actors, reference));
+    std::printf("%u core(s): %8.1f ns per actor tick, %.2fx\n", cores, ns, serial_ns / ns);
+  }
+
+  // Two frame ticks folded into one advance parallel slots as far as two separate ticks do.
+  auto pending = make_delta();
+  accumulate(pending, make_delta());
+  CHECK(pending.delta == 2.f / 60.f);
+  CHECK(pending.deltas[kTypeCount - 1] == 2.f / 60.f);
+  CHECK(pending.category_count == kTypeCount - kBuiltinTypeCount);
+
+  return 0;
+}
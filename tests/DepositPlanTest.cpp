@@ -0,0 +1,110 @@
+// The one-pass deposit plan against the old loop, which picked the ranking's selected potion, restored up to its
+// restore count and removed one potion at a time until the slots were full. Fixed cases plus random inventories
+// for every select order.
+
+import TrueFlasks.Core.DepositPlan;
+
+namespace
+{
+  using namespace core::deposit_plan;
+
+  using plan_step = step<int>;
+
+  // The old loop on a mock ranking: candidates in first found order, selection as potion_ranking::select does it.
+  auto greedy_deposit(std::vector<candidate<int>> ranking, int missing_slots, const select_order order)
+    -> std::vector<plan_step>
+  {
+    std::vector<plan_step> removed;
+    while (missing_slots > 0 && !ranking.empty()) {
+      auto selected = ranking.begin();
+      for (auto it = ranking.begin(); it != ranking.end(); ++it) {
+        if ((order == select_order::weakest_first && it->restore_count < selected->restore_count) ||
+            (order == select_order::strongest_first && it->restore_count > selected->restore_count)) {
+          selected = it;
+        }
+      }
+
+      if (selected->restore_count <= 0) {
+        break;
+      }
+      const auto restored = (std::min)(missing_slots, selected->restore_count);
+      missing_slots -= restored;
+
+      // Consecutive removals of one potion are what the plan batches into one step.
+      if (!removed.empty() && removed.back().potion == selected->potion) {
+        ++removed.back().potions_used;
+        removed.back().slots_restored += restored;
+      }
+      else {
+        removed.push_back({selected->potion, 1, restored});
+      }
+
+      if (--selected->count == 0) {
+        ranking.erase(selected);
+      }
+    }
+    return removed;
+  }
+
+  void check_matches(const std::vector<candidate<int>>& candidates, const int missing_slots, const select_order order)
+  {
+    // The ranking never holds potions without a count.
+    std::vector<candidate<int>> ranking;
+    std::ranges::copy_if(candidates, std::back_inserter(ranking),
+                         [](const candidate<int>& entry) { return entry.count > 0; });
+    const auto expected = greedy_deposit(ranking, missing_slots, order);
+
+    const auto planned = plan(std::pmr::vector<candidate<int>>(candidates.begin(), candidates.end()), missing_slots,
+                              order);
+    CHECK(planned.size() == expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      CHECK(planned[i].potion == expected[i].potion);
+      CHECK(planned[i].potions_used == expected[i].potions_used);
+      CHECK(planned[i].slots_restored == expected[i].slots_restored);
+    }
+  }
+
+  constexpr auto kOrders =
+    std::array{select_order::weakest_first, select_order::strongest_first, select_order::first_found};
+}
+
+int main()
+{
+  // Ties keep the first found potion, the last potion only restores what is missing.
+  const std::vector<candidate<int>> ties{{1, 3, 2}, {2, 2, 5}, {3, 4, 2}, {4, 1, 5}};
+  for (const auto order : kOrders) {
+    for (const int missing : {0, 1, 4, 7, 13, 40}) {
+      check_matches(ties, missing, order);
+    }
+  }
+
+  const auto strongest = plan(std::pmr::vector<candidate<int>>(ties.begin(), ties.end()), 7,
+                              select_order::strongest_first);
+  CHECK(strongest.size() == 1);
+  CHECK(strongest[0].potion == 2 && strongest[0].potions_used == 2 && strongest[0].slots_restored == 7);
+
+  // A potion that restores nothing stops the deposit where the old loop stopped.
+  const std::vector<candidate<int>> useless{{1, 2, 3}, {2, 5, 0}, {3, 2, 4}};
+  for (const auto order : kOrders) {
+    check_matches(useless, 20, order);
+  }
+
+  std::mt19937 random(20261019);
+  std::uniform_int_distribution<int> potion_count(0, 24);
+  std::uniform_int_distribution<int> count(0, 6);
+  std::uniform_int_distribution<int> restore_count(0, 6);
+  std::uniform_int_distribution<int> missing(0, 60);
+  for (int round = 0; round < 5000; ++round) {
+    std::vector<candidate<int>> candidates(static_cast<std::size_t>(potion_count(random)));
+    for (int i = 0; i < static_cast<int>(candidates.size()); ++i) {
+      candidates[static_cast<std::size_t>(i)] = {i + 1, count(random), restore_count(random)};
+    }
+    const auto slots = missing(random);
+    for (const auto order : kOrders) {
+      check_matches(candidates, slots, order);
+    }
+  }
+
+  std::puts("DepositPlanTest passed");
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Frame tick cost per actor for 4, 16 and 64 flask types: the four built-in types alone, then with 12 and 60
+// config-defined categories. Every slot is recharging, so sequential types scan all slots every tick.
+
+import TrueFlasks.Core.FlaskTick;
+
+namespace
+{
+  using namespace core::flask_tick;
+
+  struct bench_actor
+  {
+    flask_cooldown flasks[kBuiltinTypeCount][kSlotCount];
+    float anti_spam_durations[kBuiltinTypeCount]{};
+    std::vector<category_state> categories;
+  };
+
+  constexpr std::size_t kActorCount = 256;
+  constexpr int kFrames = 200;
+  // Long enough that no slot finishes during the run.
+  constexpr float kCooldown = 1000.f;
+
+  auto make_delta(const int type_count) -> delta_data
+  {
+    delta_data delta{};
+    delta.delta = 1.f / 60.f;
+    delta.category_count = type_count - kBuiltinTypeCount;
+    for (int type = 0; type < type_count; ++type) {
+      delta.deltas[type] = delta.delta;
+      // Half the types recharge in parallel, the other half one slot at a time.
+      delta.parallel[type] = type % 2 == 0;
+    }
+    return delta;
+  }
+
+  auto run(const int type_count) -> double
+  {
+    std::vector<bench_actor> actors(kActorCount);
+    for (auto& actor : actors) {
+      for (auto& type : actor.flasks) {
+        std::ranges::fill(type, flask_cooldown{kCooldown});
+      }
+      actor.categories.resize(static_cast<std::size_t>(type_count - kBuiltinTypeCount));
+      for (auto& category : actor.categories) {
+        std::ranges::fill(category.flasks, flask_cooldown{kCooldown});
+      }
+    }
+
+    const auto delta = make_delta(type_count);
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < kFrames; ++frame) {
+      for (auto& actor : actors) {
+        advance(actor.flasks, actor.anti_spam_durations, actor.categories, delta, false);
+      }
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    // Parallel types tick every slot, sequential ones only the nearest.
+    const auto& last = actors.back();
+    CHECK(last.flasks[0][kSlotCount - 1].cooldown_current < kCooldown);
+    CHECK(last.flasks[1][kSlotCount - 1].cooldown_current == kCooldown);
+    if (type_count > kBuiltinTypeCount) {
+      CHECK(last.categories.back().flasks[0].cooldown_current < kCooldown);
+    }
+
+    return elapsed / (static_cast<double>(kFrames) * kActorCount);
+  }
+}
+
+int main()
+{
+  for (const int type_count : {4, 16, 64}) {
+    std::printf("%2d flask types: %8.1f ns per actor tick\n", type_count, run(type_count));
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+// One-walk per-key counts over a mock inventory, checked against hand-computed totals and against counting
+// every key on its own.
+
+import TrueFlasks.Core.ItemCounts;
+
+namespace
+{
+  using namespace core::item_counts;
+
+  struct mock_item
+  {
+    const char* name;
+    // Bit i set: the item carries keyword i.
+    std::uint8_t keywords;
+  };
+
+  struct mock_entry
+  {
+    const mock_item* item;
+    std::int32_t count;
+    bool leveled;
+  };
+
+  constexpr mock_item kRestoreHealth{"Restore Health", 0b001};
+  constexpr mock_item kRestoreStamina{"Restore Stamina", 0b010};
+  constexpr mock_item kRestoreBoth{"Restore Both", 0b011};
+  constexpr mock_item kSold{"Sold", 0b001};
+  constexpr mock_item kPicked{"Picked", 0b010};
+
+  // Base container first, then the inventory changes, as the game stores them.
+  const std::vector<mock_entry> kBase{
+    {&kRestoreHealth, 2, false},
+    {&kRestoreStamina, 1, false},
+    // A second entry of the same object adds up.
+    {&kRestoreHealth, 3, false},
+    {&kRestoreBoth, 5, false},
+    {&kSold, 1, false},
+  };
+  const std::vector<mock_entry> kChanges{
+    {&kRestoreHealth, -1, false},
+    // Leveled entries carry the full count.
+    {&kRestoreBoth, 4, true},
+    {&kSold, -1, false},
+    {&kPicked, 2, false},
+  };
+
+  auto make_totals() -> item_totals<const mock_item*>
+  {
+    item_totals<const mock_item*> totals;
+    for (const auto& entry : kBase) {
+      totals.add_base(entry.item, entry.count);
+    }
+    for (const auto& entry : kChanges) {
+      totals.add_change(entry.item, entry.count, entry.leveled);
+    }
+    return totals;
+  }
+
+  auto has_keyword(const mock_item* item, const std::size_t keyword) -> bool
+  {
+    return (item->keywords >> keyword) & 1;
+  }
+}
+
+int main()
+{
+  const auto totals = make_totals();
+  CHECK(totals.get().at(&kRestoreHealth) == 4);
+  CHECK(totals.get().at(&kRestoreStamina) == 1);
+  CHECK(totals.get().at(&kRestoreBoth) == 4);
+  CHECK(totals.get().at(&kSold) == 0);
+  CHECK(totals.get().at(&kPicked) == 2);
+  CHECK(totals.count() == 11);
+
+  std::array<std::int32_t, 3> counts{-1, -1, -1};
+  count_per_key(totals, counts, has_keyword);
+  // Restore Both counts towards both keywords, Sold is gone, nothing carries keyword 2.
+  CHECK(counts[0] == 8);
+  CHECK(counts[1] == 7);
+  CHECK(counts[2] == 0);
+
+  for (std::size_t keyword = 0; keyword < counts.size(); ++keyword) {
+    std::int32_t single = 0;
+    count_per_key(totals, std::span{&single, 1}, [keyword](const mock_item* item, std::size_t) {
+      return has_keyword(item, keyword);
+    });
+    CHECK(single == counts[keyword]);
+  }
+
+  item_totals<const mock_item*> empty;
+  count_per_key(empty, counts, has_keyword);
+  CHECK(std::ranges::all_of(counts, [](const std::int32_t count) { return count == 0; }));
+
+  std::puts("ItemCountsTest passed");
+  return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Host tests and benchmarks only build the engine-independent modules, so they get the standard library and
+// nothing else.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+// Reports the failed expression and ends the test with a non-zero exit code.
+#define CHECK(expr)                                                                 \
+  do {                                                                              \
+    if (!(expr)) {                                                                  \
+      std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #expr); \
+      std::exit(1);                                                                 \
+    }                                                                               \
+  } while (false)
@@ -57,3 +57,25 @@ add_includedirs("src")
 set_pcxxheader("src/pch.h")
 add_headerfiles("src/**.h", "src/**.hpp", "src/**.html", "src/**.js", "src/**.css", "src/**.svg", "src/**.ttf")
 add_files("src/**.cpp")
+
+-- host tests and benchmarks: `xmake build -g tests && xmake test`
+-- each links only the engine-independent modules it imports
+local host_tests = {
+    ActorTickScalingBenchmark = {"src/Core/FlaskTick.cpp", "src/Core/ThreadPool.cpp"},
+    DepositPlanTest = {"src/Core/DepositPlan.cpp"},
+    FlaskCategoriesBenchmark = {"src/Core/FlaskTick.cpp"},
+    ItemCountsTest = {"src/Core/ItemCounts.cpp"}
+}
+
+for name, modules in pairs(host_tests) do
+    target(name)
+        set_kind("binary")
+        set_default(false)
+        set_group("tests")
+        set_policy("build.c++.modules", true)
+        set_pcxxheader("tests/pch.h")
+        add_files("tests/" .. name .. ".cpp")
+        add_files(table.unpack(modules))
+        add_tests("default")
+    target_end()
+end